@@ -3,7 +3,15 @@
 IF NOT EXIST build MKDIR build
 PUSHD build
 
-CL -nologo -FC -Zi ..\code\snake.cpp ..\ext\glad\src\glad.c -I ..\ext -I ..\ext\SDL\include -I ..\ext\glad\include -link -SUBSYSTEM:CONSOLE -LIBPATH:..\ext\SDL\lib\x64\ SDL2.lib SDL2main.lib shell32.lib
+CL -nologo -FC -Zi -O2 -EHsc -c ..\code\snake_sim.cpp ..\code\snake_batch.cpp ..\code\snake_rollout.cpp ..\code\snake_replay.cpp ..\code\snake_autopilot.cpp ..\code\snake_mcts.cpp
+LIB -nologo snake_sim.obj snake_batch.obj snake_rollout.obj snake_replay.obj snake_autopilot.obj snake_mcts.obj -OUT:snake_sim.lib
+
+CL -nologo -FC -Zi -EHsc ..\code\snake.cpp ..\code\snake_render.cpp ..\code\snake_atlas.cpp ..\code\snake_profiler.cpp ..\code\snake_watch.cpp ..\ext\glad\src\glad.c -I ..\ext -I ..\ext\SDL\include -I ..\ext\glad\include -link -SUBSYSTEM:CONSOLE -LIBPATH:..\ext\SDL\lib\x64\ SDL2.lib SDL2main.lib shell32.lib snake_sim.lib
+CL -nologo -FC -Zi -O2 ..\code\snake_headless.cpp -link -SUBSYSTEM:CONSOLE snake_sim.lib
+CL -nologo -FC -Zi -O2 ..\code\snake_bake.cpp ..\code\snake_atlas.cpp -I ..\ext -link -SUBSYSTEM:CONSOLE snake_sim.lib
+CL -nologo -FC -Zi -O2 -EHsc ..\code\snake_bench.cpp ..\code\snake_render.cpp ..\code\snake_atlas.cpp ..\code\snake_profiler.cpp ..\ext\glad\src\glad.c -I ..\ext -I ..\ext\SDL\include -I ..\ext\glad\include -link -SUBSYSTEM:CONSOLE -LIBPATH:..\ext\SDL\lib\x64\ SDL2.lib SDL2main.lib shell32.lib snake_sim.lib
 
 COPY *.exe ..
 POPD
+
+snake_bake.exe
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Headless Linux build: the simulation library and the tools that only link it.
+
+mkdir -p build
+cd build || exit 1
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-O2 -g -std=c++11 -Wall -march=native"}
+
+$CXX $CXXFLAGS -c ../code/snake_sim.cpp -o snake_sim.o || exit 1
+$CXX $CXXFLAGS -c ../code/snake_batch.cpp -o snake_batch.o || exit 1
+$CXX $CXXFLAGS -c ../code/snake_rollout.cpp -o snake_rollout.o || exit 1
+$CXX $CXXFLAGS -c ../code/snake_replay.cpp -o snake_replay.o || exit 1
+$CXX $CXXFLAGS -c ../code/snake_autopilot.cpp -o snake_autopilot.o || exit 1
+$CXX $CXXFLAGS -c ../code/snake_mcts.cpp -o snake_mcts.o || exit 1
+ar rcs libsnake_sim.a snake_sim.o snake_batch.o snake_rollout.o snake_replay.o snake_autopilot.o snake_mcts.o || exit 1
+
+$CXX $CXXFLAGS ../code/snake_headless.cpp -L. -lsnake_sim -lpthread -o snake_headless || exit 1
+
+# Bake data/ into the pack file the game and the benchmark load at startup.
+$CXX $CXXFLAGS -I../ext ../code/snake_bake.cpp ../code/snake_atlas.cpp -L. -lsnake_sim -o snake_bake || exit 1
+(cd .. && build/snake_bake) || exit 1
+
+# The benchmark draws through a surfaceless Mesa EGL context.
+${CC:-cc} -O2 -I../ext/glad/include -c ../ext/glad/src/glad.c -o glad.o || exit 1
+$CXX $CXXFLAGS -I../ext -I../ext/glad/include ../code/snake_bench.cpp ../code/snake_render.cpp ../code/snake_atlas.cpp ../code/snake_profiler.cpp glad.o -L. -lsnake_sim -lEGL -ldl -lpthread -o snake_bench || exit 1
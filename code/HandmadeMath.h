@@ -307,7 +307,7 @@ typedef union HMM_Vec3
     struct
     {
         HMM_Vec2 xy;
-        float _Ignored0;
+        float _ignored0;
     };
 
     struct
@@ -317,7 +317,7 @@ typedef union HMM_Vec3
     };
     struct
     {
-        float _Ignored1;
+        float _ignored1;
         HMM_Vec2 yz;
     };
 
@@ -329,7 +329,7 @@ typedef union HMM_Vec3
     struct
     {
         HMM_Vec2 uv;
-        float _Ignored2;
+        float _ignored2;
     };
 
     struct
@@ -339,7 +339,7 @@ typedef union HMM_Vec3
     };
     struct
     {
-        float _Ignored3;
+        float _ignored3;
         HMM_Vec2 vw;
     };
 
@@ -420,8 +420,8 @@ typedef union HMM_Vec4
     struct
     {
         HMM_Vec2 xy;
-        float _Ignored0;
-        float _Ignored1;
+        float _ignored0;
+        float _ignored1;
     };
 
     struct
@@ -432,9 +432,9 @@ typedef union HMM_Vec4
     };
     struct
     {
-        float _Ignored2;
+        float _ignored2;
         HMM_Vec2 yz;
-        float _Ignored3;
+        float _ignored3;
     };
 
     struct
@@ -445,8 +445,8 @@ typedef union HMM_Vec4
     };
     struct
     {
-        float _Ignored4;
-        float _Ignored5;
+        float _ignored4;
+        float _ignored5;
         HMM_Vec2 zw;
     };
 
@@ -1,309 +1,267 @@
 #include <SDL.h>
-#include <glad/glad.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-#define HANDMADE_MATH_USE_DEGREES
-#include "HandmadeMath.h"
-
 #include <stdlib.h>
 #include <stdio.h>
-
-typedef uint8_t  u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef int8_t   s8;
-typedef int16_t  s16;
-typedef int32_t  s32;
-typedef int64_t  s64;
-typedef float  f32;
-typedef double f64;
-typedef s32 b32;
-
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "snake_base.h"
+#include "snake_sim.h"
+#include "snake_rollout.h"
+#include "snake_replay.h"
+#include "snake_autopilot.h"
+#include "snake_render.h"
+#include "snake_profiler.h"
+#include "snake_watch.h"
+#include "snake_handoff.h"
 #include "snake.h"
 
 #define WIDTH 1280
 #define HEIGHT 720
 #define CELL_Y 20
-#define MAX_CELLS 512
-
-u32 quad_shader;
-u32 quad_vao;
-u32 grid_vao;
-u32 text_vao;
-
-u32 gl_texture_create(const char *texture_path) {
-    stbi_set_flip_vertically_on_load(true);
-    int tex_width, tex_height, n;
-    unsigned char *tex_data = stbi_load(texture_path, &tex_width, &tex_height, &n, 4);
-    if (tex_data == NULL) {
-        printf("Failed to load texture: %s\n", texture_path);
-    }
-
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_width, tex_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void *)tex_data);
-
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(tex_data);
-    return texture;
+// Idle pacing: frames for the apple's spin when the window is out of
+// focus, and how often the shader watch is checked while waiting.
+#define UNFOCUSED_FRAME_MS 33
+#define WATCH_POLL_MS 250
+
+// The render thread owns the GL context and draws whichever FrameState the
+// sim thread published last, so a slow swap or a driver stall never holds
+// up input or a tick.
+struct RenderThread {
+    SDL_Window *window;
+    SDL_GLContext context;
+    int board_width;
+    int board_height;
+    b32 hot_reload;
+    b32 idle;
+
+    Handoff handoff;
+    FrameState frames[HANDOFF_SLOTS];
+    SnapshotPool games;  // the board for each frame slot
+
+    std::atomic<b32> quit;
+    std::atomic<b32> failed;  // set if the renderer could not start
+    // Only for sleeping with nothing to draw; frames never take the lock.
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::thread thread;
+};
+
+static void render_wake(RenderThread *render) {
+    // Taking the lock between the change and the notify means the render
+    // thread has either not checked yet or is already waiting.
+    { std::lock_guard<std::mutex> lock(render->wake_mutex); }
+    render->wake.notify_one();
 }
 
-u32 gl_shader_create(const char *vertex_src, const char *frag_src) {
-    u32 shader = glCreateProgram();
-    int status = 0;
-    int n;
-    char log[512] = {};
-
-    u32 vshader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vshader, 1, &vertex_src, nullptr);
-    glCompileShader(vshader);
-    glGetShaderiv(vshader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        printf("Failed to compile vertex shader!\n");
-    }
-
-    glGetShaderInfoLog(vshader, 512, &n, log);
-    if (n > 0) {
-        printf("Error in vertex shader!\n");
-        printf(log);
-    }
-
-    u32 fshader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fshader, 1, &frag_src, nullptr);
-    glCompileShader(fshader);
-    glGetShaderiv(vshader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        printf("Failed to compile fragment shader!\n");
-    }
-    
-    glGetShaderInfoLog(fshader, 512, &n, log);
-    if (n > 0) {
-        printf("Error in fragment shader!\n");
-        printf(log);
+static void publish_frame(RenderThread *render, FrameState *state, GameState *game) {
+    u32 slot = render->handoff.back;
+    render->frames[slot] = *state;
+    if (state->mode == Mode_Play) {
+        game_snapshot(game, snapshot_slot(&render->games, slot));
     }
-
-    glAttachShader(shader, vshader);
-    glAttachShader(shader, fshader);
-    glLinkProgram(shader);
-    glDeleteShader(vshader);
-    glDeleteShader(fshader);
-
-    return shader;
-}
-
-u32 gl_shader_create_file(const char *vertex_name, const char *frag_name) {
-    char *vertex_src = nullptr;
-    char *frag_src = nullptr;
-    FILE *file = fopen(vertex_name, "rb");
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    vertex_src = (char *)malloc(size + 1);
-    fread(vertex_src, 1, size, file);
-    vertex_src[size] = '\0';
-    fclose(file);
-    file = fopen(frag_name, "rb");
-    fseek(file, 0, SEEK_END);
-    size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    frag_src = (char *)malloc(size + 1);
-    fread(frag_src, 1, size, file);
-    frag_src[size] = '\0';
-    fclose(file);
-
-    u32 result = gl_shader_create(vertex_src, frag_src);
-
-    free(vertex_src);
-    free(frag_src);
-    return result;
+    handoff_publish(&render->handoff);
+    render_wake(render);
 }
 
-void draw_quad(HMM_Vec2 translation, HMM_Vec2 scale, f32 rotation, HMM_Mat4 projection, u32 texture) {
-    HMM_Mat4 model = HMM_M4D(1.0f);
-    model = model * HMM_Translate(HMM_V3(translation.X, translation.Y, 0.0f));
-
-    model = model * HMM_Translate(HMM_V3(0.5f * scale.X, 0.5f * scale.Y, 0.0f));
-    model = model * HMM_Rotate_LH(rotation, HMM_V3(0.0f, 0.0f, 1.0f));
-    model = model * HMM_Translate(HMM_V3(-0.5f * scale.X, -0.5f * scale.Y, 0.0f));
-
-    model = model * HMM_Scale(HMM_V3(scale.X, scale.Y, 1.0));
-    model = projection * model;
-
-    glBindVertexArray(quad_vao);
-    glUseProgram(quad_shader);
-    glUniformMatrix4fv(glGetUniformLocation(quad_shader, "wvp"), 1, false, (f32 *)&model);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+// Whether state differs from the last published frame in anything the
+// render thread draws or paces by. The zone times are left out and go out
+// with the next real change.
+static b32 frame_changed(FrameState *state, FrameState *published) {
+    return state->mode != published->mode || state->start_selected != published->start_selected ||
+           state->exit_selected != published->exit_selected || state->show_profiler != published->show_profiler ||
+           state->window_width != published->window_width || state->window_height != published->window_height ||
+           state->window_visible != published->window_visible ||
+           state->window_focused != published->window_focused || state->cell_size != published->cell_size;
 }
 
-void draw_grid(HMM_Vec2 window_dim, f32 cell_size, u32 texture, HMM_Mat4 projection) {
-
-    f32 cell_x = (window_dim.Width / cell_size) / 2.0f;
-    f32 cell_y = (window_dim.Height / cell_size) / 2.0f;
+// Draws only when there is something new to show: a published frame, a
+// shader reload or the apple's spin. Play is redrawn every frame while
+// focused, at UNFOCUSED_FRAME_MS otherwise and only as ticks are published
+// while hidden; the other screens wait for the sim thread. --no-idle draws
+// every frame regardless.
+static void render_main(RenderThread *render) {
+    SDL_GL_MakeCurrent(render->window, render->context);
+    gladLoadGLLoader(SDL_GL_GetProcAddress);
+    gl_load_extensions(SDL_GL_GetProcAddress);
+
+    // Without a renderer the game cannot run, so ask the sim thread to quit.
+    if (!render_init()) {
+        render->failed = true;
+        SDL_Event quit{};
+        quit.type = SDL_QUIT;
+        SDL_PushEvent(&quit);
+        return;
+    }
+    profiler_init();
 
-    f32 grid_verts[] = {
-        0.0f, 0.0f,                            0.0f, 0.0f,
-        0.0f, window_dim.Height,               0.0f, cell_y,
-        window_dim.Width, window_dim.Height,   cell_x, cell_y,
+    // Shader edits show up on the next frame.
+    FileWatch shader_watch;
+    if (render->hot_reload) {
+        watch_start(&shader_watch, "data/shaders");
+    }
 
-        0.0f, 0.0f,                            0.0f, 0.0f,
-        window_dim.Width, window_dim.Height,   cell_x, cell_y,
-        window_dim.Width, 0.0f,                cell_x, 0.0f
-    };
+    // The fixed strings are laid out once.
+    TextMesh menu_text{}, game_over_text{}, won_text{};
+    text_set(&menu_text, "SNAKE 2D\nSTART\nEXIT", HMM_V2(400.0f, 600.0f), 50.0f);
+    text_set(&game_over_text, "GAME OVER", HMM_V2(400.0f, 600.0f), 40.0f);
+    text_set(&won_text, "YOU WIN", HMM_V2(400.0f, 600.0f), 40.0f);
+
+    // The board as of the frame being drawn.
+    GameState game;
+    game_init(&game, render->board_width, render->board_height, 0);
+
+    int viewport_width = 0, viewport_height = 0;
+    HMM_Mat4 projection{};
+    u32 last_frame = 0;
+
+    while (!render->quit.load()) {
+        b32 fresh = handoff_acquire(&render->handoff);
+        FrameState *frame = &render->frames[render->handoff.front];
+        b32 reloaded = false;
+        if (render->hot_reload && watch_changed(&shader_watch)) {
+            printf(render_reload_shaders() ? "Reloaded shaders\n" : "Shader reload failed, keeping the old ones\n");
+            reloaded = true;
+        }
 
-    glBindVertexArray(grid_vao);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(grid_verts), (void *)grid_verts);
-    glUniformMatrix4fv(glGetUniformLocation(quad_shader, "wvp"), 1, false, (float *)&projection);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-}
+        if (render->idle && !fresh && !reloaded) {
+            s32 frame_ms = -1;
+            if (frame->window_visible && (frame->mode == Mode_Play || frame->show_profiler)) {
+                frame_ms = frame->window_focused ? 0 : UNFOCUSED_FRAME_MS;
+            }
+            s32 wait = frame_ms < 0 ? -1 : HMM_MAX((s32)(last_frame + frame_ms - SDL_GetTicks()), 0);
+            // The shader watch is polled, so wake up for it as well.
+            if (render->hot_reload && (wait < 0 || wait > WATCH_POLL_MS)) wait = WATCH_POLL_MS;
+
+            if (wait != 0) {
+                std::unique_lock<std::mutex> lock(render->wake_mutex);
+                auto woken = [render] { return render->quit.load() || handoff_fresh(&render->handoff); };
+                if (wait < 0) {
+                    render->wake.wait(lock, woken);
+                } else {
+                    render->wake.wait_for(lock, std::chrono::milliseconds(wait), woken);
+                }
+                continue;
+            }
+        }
+        last_frame = SDL_GetTicks();
+
+        profiler.shown = frame->show_profiler;
+        profile_frame_begin();
+        profiler.zone_ns[Zone_Events] = frame->events_ns;
+        profiler.zone_ns[Zone_Sim] = frame->sim_ns;
+
+        if (frame->window_width != viewport_width || frame->window_height != viewport_height) {
+            viewport_width = frame->window_width;
+            viewport_height = frame->window_height;
+            glViewport(0, 0, viewport_width, viewport_height);
+            projection = HMM_Orthographic_RH_NO(0.0f, (f32)viewport_width, 0.0f, (f32)viewport_height, -1.0f, 1.0f);
+        }
+        HMM_Vec2 window_dim = HMM_V2((f32)viewport_width, (f32)viewport_height);
 
+        gl_set_blend(true);
 
-HMM_Vec2 direction_vector(Dir dir) {
-    HMM_Vec2 result{};
-    switch (dir) {
-    case Left:
-        result.X = -1.0f;
-        break;
-    case Right:
-        result.X = 1.0f;
-        break;
-    case Up:
-        result.Y = 1.0f;
-        break;
-    case Down:
-        result.Y = -1.0f;
-        break;
-    }
-    return result;
-}
+        // Play copies the background over the whole window instead.
+        if (frame->mode != Mode_Play) {
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        sprite_begin(projection);
 
-f32 direction_rotation(Dir dir) {
-    f32 rot = 0.0f;
-    switch (dir) {
-    case Left:
-        rot = 180.0f;
-        break;
-    case Right:
-        rot = 0.0f;
-        break;
-    case Up:
-        rot = 90.0f;
-        break;
-    case Down:
-        rot = 270.0f;
-        break;
-    }
+        if (frame->mode == Mode_Start) {
+            profile_begin(Zone_Text);
+            push_text_mesh(Layer_Text, &menu_text);
+            profile_end(Zone_Text);
 
-    return rot;
-}
+            if (frame->start_selected) {
+                push_quad(Layer_Sprites, HMM_V2(400.0f - 50.0f, 550.0f), HMM_V2(50.0f, 50.0f), 0.0f, Sprite_Arrow);
+            } else if (frame->exit_selected) {
+                push_quad(Layer_Sprites, HMM_V2(400.0f - 50.0f, 500.0f), HMM_V2(50.0f, 50.0f), 0.0f, Sprite_Arrow);
+            }
+        } else if (frame->mode == Mode_Play) {
+            if (fresh) {
+                game_restore(&game, snapshot_slot(&render->games, render->handoff.front));
+            }
+            f32 blend = (f32)(SDL_GetPerformanceCounter() - frame->tick_counter) / (f32)frame->tick_counts;
+            draw_play(&game, &frame->trail, HMM_MIN(blend, 1.0f), window_dim, frame->cell_size,
+                      (f32)SDL_GetTicks() * 0.1f);
+        } else if (frame->mode == Mode_End) {
+            profile_begin(Zone_Text);
+            push_text_mesh(Layer_Text, &game_over_text);
+            profile_end(Zone_Text);
+        } else if (frame->mode == Mode_Won) {
+            profile_begin(Zone_Text);
+            push_text_mesh(Layer_Text, &won_text);
+            profile_end(Zone_Text);
+        }
 
-void snake_step(Cell *snake_cells, int snake_length) {
-    Dir dir = snake_cells[0].dir;
-    snake_cells[0].x += (dir==Left) ? -1 : (dir==Right) ? 1 : 0;
-    snake_cells[0].y += (dir==Down) ? -1 : (dir==Up) ? 1 : 0;
+        draw_profiler(window_dim.Height);
+        profile_begin(Zone_Flush);
+        sprite_flush();
+        profile_end(Zone_Flush);
+        profile_gpu_end();
 
-    for (int i = snake_length - 1; i > 0; i--) {
-        Dir dir = snake_cells[i].dir;
-        snake_cells[i].x += (dir==Left) ? -1 : (dir==Right) ? 1 : 0;
-        snake_cells[i].y += (dir==Down) ? -1 : (dir==Up) ? 1 : 0;
-        snake_cells[i].dir = snake_cells[i - 1].dir;
+        profile_begin(Zone_Swap);
+        SDL_GL_SwapWindow(render->window);
+        profile_end(Zone_Swap);
+        profile_frame_end();
     }
-}
 
-void grow_snake(Cell *snake_cells, int snake_length) {
-    Cell tail = snake_cells[snake_length - 1];
-    Cell new_cell = tail;
-    switch (tail.dir) {
-    case Left:
-        new_cell.x += 1;
-        break;
-    case Right:
-        new_cell.x -= 1;
-        break;
-    case Up:
-        new_cell.y -= 1;
-        break;
-    case Down:
-        new_cell.y += 1;
-        break;
+    if (render->hot_reload) {
+        watch_stop(&shader_watch);
     }
-    snake_cells[snake_length] = new_cell;
+    text_free(&menu_text);
+    text_free(&game_over_text);
+    text_free(&won_text);
+    game_free(&game);
 }
 
-Cell spawn_apple(Cell *snake_cells, int snake_length, int cell_x, int cell_y) {
-    Cell result{};
-    srand(SDL_GetTicks());
-    for (;;) {
-        int x = rand() % cell_x;
-        int y = rand() % cell_y;
-        b32 collision = false;
-        for (int i = 0; i < snake_length; i++) {
-            if (x == snake_cells[i].x && y == snake_cells[i].y) {
-                collision = true;
-            }
-        }
-
-        if (!collision) {
-            result.x = x;
-            result.y = y;
-            break;
+int main(int argc, char **argv) {
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    f32 replay_speed = 1.0f;
+    f32 tick_rate = 10.0f;
+    b32 autopilot_enabled = false;
+    b32 hot_reload = false;
+    b32 idle = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            return rollout_main(argc, argv);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--autopilot") == 0) {
+            autopilot_enabled = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profiler.shown = true;
+        } else if (strcmp(argv[i], "--hot-reload") == 0) {
+            hot_reload = true;
+        } else if (strcmp(argv[i], "--no-idle") == 0) {
+            idle = false;
+        } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            tick_rate = (f32)atof(argv[++i]);
+            if (tick_rate <= 0.0f) tick_rate = 10.0f;
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            replay_speed = (f32)atof(argv[++i]);
+            if (replay_speed <= 0.0f) replay_speed = 1.0f;
         }
     }
-    return result;
-}
-
-void draw_text(const char *text, HMM_Vec2 start, f32 char_size, u32 texture, HMM_Mat4 projection) {
-    int vert_count = 0;
-    QuadV vertices[1024]{};
 
-    HMM_Vec2 pos = start;
-    f32 glyph_step = 8.0f / 472.0f;
-    
-    for (const char *ptr = text; *ptr; ptr++) {
-        char ch = *ptr;
-        if (ch == '\n') {
-            pos.x = start.x;
-            pos.y -= char_size;
-            continue;
+    ReplayFile replay_file{};
+    ReplayRecord replay{};
+    ReplayCursor replay_cursor{};
+    if (replay_path) {
+        if (!replay_open(&replay_file, replay_path) || !replay_next(&replay_file, &replay)) {
+            return -1;
         }
-
-        f32 char_off = (f32)(ch - ' ');
-        f32 off_x = char_off * glyph_step;
-
-        vertices[vert_count++] = {pos.x, pos.y,                          off_x, 0.0f};
-        vertices[vert_count++] = {pos.x, pos.y + char_size,              off_x, 1.0f};
-        vertices[vert_count++] = {pos.x + char_size, pos.y + char_size,  off_x + glyph_step, 1.0f};
-        vertices[vert_count++] = {pos.x, pos.y,                          off_x, 0.0f};
-        vertices[vert_count++] = {pos.x + char_size, pos.y + char_size,  off_x + glyph_step, 1.0f};
-        vertices[vert_count++] = {pos.x + char_size, pos.y,              off_x + glyph_step, 0.0f};
-
-        pos.x += char_size;
+        replay_cursor_init(&replay_cursor, &replay);
     }
 
-    glBindVertexArray(text_vao);
-    glBufferData(GL_ARRAY_BUFFER, vert_count * sizeof(QuadV), vertices, GL_DYNAMIC_DRAW);
-
-    glVertexAttribPointer(0, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)(2 * sizeof(f32)));
-
-    glUseProgram(quad_shader);
-    glUniformMatrix4fv(glGetUniformLocation(quad_shader, "wvp"), 1, false, (f32 *)&projection);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glDrawArrays(GL_TRIANGLES, 0, vert_count);
-}
-
-int main(int argc, char **argv) {
     if (SDL_Init(SDL_INIT_VIDEO)) {
         SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL Error", "Failed to initialize SDL Video", NULL);
         return -1;
@@ -323,78 +281,8 @@ int main(int argc, char **argv) {
     }
     
     SDL_GLContext context = SDL_GL_CreateContext(window);
-    gladLoadGLLoader(SDL_GL_GetProcAddress);
-
-    u32 arrow_texture = gl_texture_create("data/arrow.png");
-    u32 cell_texture = gl_texture_create("data/cell.png");
-    u32 apple_texture = gl_texture_create("data/apple.png");
-    u32 font_texture = gl_texture_create("data/font.png");
-    u32 grid_texture = gl_texture_create("data/grid.png");
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    const char *quad_vshader = "#version 330 core\n"
-        "layout (location = 0) in vec2 in_pos;\n"
-        "layout (location = 1) in vec2 in_uv;\n"
-        "uniform mat4 wvp;\n"
-        "out vec2 uv;\n"
-        "void main() {\n"
-        "gl_Position = wvp * vec4(in_pos, 0.0, 1.0);\n"
-        "uv = in_uv;\n"
-        "}\0";
-    const char *quad_fshader = "#version 330 core\n"
-        "in vec2 uv;\n"
-        "uniform sampler2D quad_tex;\n"
-        "out vec4 out_color;\n"
-        "void main() {\n"
-        "out_color = texture(quad_tex, uv);\n"
-        "}\0";
-
-    quad_shader = gl_shader_create(quad_vshader, quad_fshader);
-
-    f32 quad_verts[] = {
-        0.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f,
-
-        0.0f, 0.0f, 0.0f, 0.0f,
-        1.0f, 1.0f, 1.0f, 1.0f,
-        1.0f, 0.0f, 1.0f, 0.0f,
-    };
-
-    u32 quad_vbo;
-    glGenBuffers(1, &quad_vbo);
-    glGenVertexArrays(1, &quad_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quad_verts), quad_verts, GL_STATIC_DRAW);
-    glBindVertexArray(quad_vao);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)(2 * sizeof(f32)));
-    glBindVertexArray(0);
-
-    u32 text_vbo;
-    glGenBuffers(1, &text_vbo);
-    glGenVertexArrays(1, &text_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, text_vbo);
-    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
-    glBindVertexArray(text_vao);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glBindVertexArray(0);
-
-    u32 grid_vbo;
-    glGenBuffers(1, &grid_vbo);
-    glGenVertexArrays(1, &grid_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, grid_vbo);
-    glBufferData(GL_ARRAY_BUFFER, 6 * 4 * sizeof(f32), 0, GL_STATIC_DRAW);
-    glBindVertexArray(grid_vao);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)(2 * sizeof(f32)));
-    glBindVertexArray(0);
+    // The render thread makes it current on itself.
+    SDL_GL_MakeCurrent(window, NULL);
 
     int window_width, window_height;
     SDL_GetWindowSize(window, &window_width, &window_height);
@@ -402,34 +290,137 @@ int main(int argc, char **argv) {
     int cell_y = CELL_Y;
     f32 cell_size = (f32)window_height / (f32)cell_y;
     int cell_x = (int)(window_width / cell_size);
+    u64 seed = SDL_GetPerformanceCounter();
+    f32 tick_seconds = 1.0f / tick_rate;
+    if (replay_path) {
+        // Replays keep their recorded board and are scaled to fit the window.
+        cell_x = replay.header.width;
+        cell_y = replay.header.height;
+        cell_size = HMM_MIN((f32)window_width / (f32)cell_x, (f32)window_height / (f32)cell_y);
+        seed = replay.header.seed;
+        tick_seconds /= replay_speed;
+    }
    
     Dir selected_dir = Right;
     
-    int snake_length = 1;
-    Cell *snake_cells = (Cell *)calloc(MAX_CELLS, sizeof(Cell));
-    snake_cells[0] = Cell(0, 4, Right);
+    GameState game;
+    game_init(&game, cell_x, cell_y, seed);
 
-    Cell apple = spawn_apple(snake_cells, snake_length, cell_x, cell_y);
+    Autopilot autopilot;
+    autopilot_create(&autopilot, cell_x, cell_y);
+
+    ReplayWriter recording{};
+    b32 recording_saved = false;
+    if (record_path) {
+        replay_begin(&recording, &game, seed);
+    }
 
     Input input{};
     bool window_should_close = false; 
-    GameState game_state{};
+    GameMode game_mode = replay_path ? Mode_Play : Mode_Start;
     b32 start_selected = true;
     b32 exit_selected = false;
 
-    u32 start_time = SDL_GetTicks();
+    // Fixed timestep: real time goes into the accumulator and comes out as
+    // whole ticks, as many as fit, so the sim keeps its pace whatever the
+    // frame rate. What is left over is how far into the next tick we are,
+    // and the render thread draws the snake that far along.
+    u64 perf_frequency = SDL_GetPerformanceFrequency();
+    u64 tick_counts = HMM_MAX((u64)(tick_seconds * (f64)perf_frequency), 1);
+    // After a stall, time past this is dropped instead of run as a burst.
+    u64 max_backlog = HMM_MAX(perf_frequency / 4, tick_counts);
+    u64 accumulator = 0;
+    u64 last_counter = SDL_GetPerformanceCounter();
+    SnakeTrail trail{};
+
+    FrameState state{};
+    state.mode = game_mode;
+    state.start_selected = start_selected;
+    state.show_profiler = profiler.shown;
+    state.window_width = window_width;
+    state.window_height = window_height;
+    state.window_visible = true;
+    state.window_focused = true;
+    state.cell_size = cell_size;
+    state.tick_counter = last_counter;
+    state.tick_counts = tick_counts;
+
+    RenderThread render;
+    render.window = window;
+    render.context = context;
+    render.board_width = cell_x;
+    render.board_height = cell_y;
+    render.hot_reload = hot_reload;
+    render.idle = idle;
+    render.games = snapshot_pool_create(cell_x, cell_y, HANDOFF_SLOTS);
+    render.quit = false;
+    render.failed = false;
+    handoff_init(&render.handoff);
+    // The first frame goes out before the thread starts, so it always has
+    // one to draw.
+    publish_frame(&render, &state, &game);
+    FrameState published = state;
+    u64 published_ticks = game.ticks;
+    render.thread = std::thread(render_main, &render);
+
+    // This thread only handles input and the sim, and sleeps until an event
+    // arrives or, in play, the next tick is due. It never waits on GL.
     while (!window_should_close) {
+        if (game_mode == Mode_Play) {
+            u64 pending = accumulator + (SDL_GetPerformanceCounter() - last_counter);
+            if (pending < tick_counts) {
+                s32 tick_in = (s32)(((tick_counts - pending) * 1000 + perf_frequency - 1) / perf_frequency);
+                SDL_WaitEventTimeout(NULL, tick_in);
+            }
+        } else {
+            SDL_WaitEvent(NULL);
+        }
+
+        u64 counter = SDL_GetPerformanceCounter();
+        if (game_mode == Mode_Play) {
+            accumulator = HMM_MIN(accumulator + (counter - last_counter), max_backlog);
+        } else {
+            accumulator = 0;
+        }
+        last_counter = counter;
+
+        u64 events_start = profile_now_ns();
         SDL_Event event;
         while (SDL_PollEvent(&event)) { 
             switch (event.type) {
             case SDL_WINDOWEVENT: {
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    glViewport(0, 0, event.window.data1, event.window.data2);
+                switch (event.window.event) {
+                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                    state.window_width = event.window.data1;
+                    state.window_height = event.window.data2;
+                    break;
+                case SDL_WINDOWEVENT_HIDDEN:
+                case SDL_WINDOWEVENT_MINIMIZED:
+                    state.window_visible = false;
+                    break;
+                case SDL_WINDOWEVENT_SHOWN:
+                case SDL_WINDOWEVENT_EXPOSED:
+                case SDL_WINDOWEVENT_RESTORED:
+                case SDL_WINDOWEVENT_MAXIMIZED:
+                    state.window_visible = true;
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_GAINED:
+                    state.window_focused = true;
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_LOST:
+                    state.window_focused = false;
+                    break;
                 }
             } break;
             case SDL_KEYDOWN:
             case SDL_KEYUP: {
                 b32 is_down = event.key.state == SDL_PRESSED;
+                if (event.key.keysym.sym == 'p' && is_down && !event.key.repeat) {
+                    autopilot_enabled = !autopilot_enabled;
+                }
+                if (event.key.keysym.sym == SDLK_F3 && is_down && !event.key.repeat) {
+                    state.show_profiler = !state.show_profiler;
+                }
                 switch (event.key.keysym.sym) {
                 case SDLK_RETURN:
                     input.enter = is_down;
@@ -457,17 +448,10 @@ int main(int argc, char **argv) {
                 break;
             }
         }
-      
-        SDL_GetWindowSize(window, &window_width, &window_height);
-        HMM_Mat4 projection = HMM_Orthographic_RH_NO(0.0f, (float)window_width, 0.0f, (float)window_height, -1.0f, 1.0f);
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.events_ns = profile_now_ns() - events_start;
 
-        glClear(GL_COLOR_BUFFER_BIT);
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-
-        if (game_state.game_mode == Mode_Start) {
+        u64 sim_start = profile_now_ns();
+        if (game_mode == Mode_Start) {
             if (input.up) {
                 if (exit_selected) {
                     start_selected = true;
@@ -482,21 +466,13 @@ int main(int argc, char **argv) {
 
             if (input.enter) {
                 if (start_selected) {
-                    game_state.game_mode = Mode_Play;
+                    game_mode = Mode_Play;
                 } else if (exit_selected) {
                     window_should_close = true;
                 }
             }
- 
-            draw_text("SNAKE 2D\nSTART\nEXIT", HMM_V2(400.0f, 600.0f), 50.0f, font_texture, projection);
-           
-            if (start_selected) {
-                draw_quad(HMM_V2(400.0f - 50.0f, 550.0f), HMM_V2(50.0f, 50.0f), 0.0f, projection, arrow_texture);
-            } else if (exit_selected) {
-                draw_quad(HMM_V2(400.0f - 50.0f, 500.0f), HMM_V2(50.0f, 50.0f), 0.0f, projection, arrow_texture);
-            }
-        } else if (game_state.game_mode == Mode_Play) {
-            Dir dir = snake_cells[0].dir;
+        } else if (game_mode == Mode_Play) {
+            Dir dir = game.dir;
             if (input.left && dir != Right) {
                 selected_dir = Left;
             }
@@ -510,53 +486,76 @@ int main(int argc, char **argv) {
                 selected_dir = Down;
             }
 
-            f32 time = (f32)(SDL_GetTicks() - start_time) / 1000.0f;
-            if (time >= 0.1f) {
-                snake_cells[0].dir = selected_dir;
-                snake_step(snake_cells, snake_length);
-
-                // Death
-                Cell *head = snake_cells;
-                if (head->x > cell_x || head->x < 0 || head->y < 0 || head->y > cell_y) {
-                    game_state.game_mode = Mode_End;
+            while (accumulator >= tick_counts && game_mode == Mode_Play) {
+                accumulator -= tick_counts;
+                // Only the last tick published is drawn part way through.
+                if (accumulator < tick_counts) {
+                    snake_trail_save(&trail, &game);
                 }
-                for (int i = 1; i < snake_length + 1; i++) {
-                    if (head->x == snake_cells[i].x && head->y == snake_cells[i].y) {
-                        game_state.game_mode = Mode_End;
-                    }
+                if (autopilot_enabled) {
+                    selected_dir = autopilot_choose(&autopilot, &game);
+                }
+                SimInput sim_input{};
+                sim_input.turn = selected_dir;
+                if (replay_path) {
+                    sim_input.turn = replay_cursor_turn(&replay_cursor, game.ticks);
+                }
+                GameStatus status = game_step(&game, sim_input);
+                if (record_path) {
+                    replay_record(&recording, &game);
+                }
+                if (replay_path && game.ticks >= replay.header.ticks && status == Game_Playing) {
+                    status = Game_Dead;
+                }
+                if (status == Game_Dead) {
+                    game_mode = Mode_End;
+                } else if (status == Game_Won) {
+                    game_mode = Mode_Won;
+                }
+                if (status != Game_Playing && record_path && !recording_saved) {
+                    replay_finish(&recording, &game);
+                    recording_saved = replay_write_file(&recording, record_path, false);
                 }
-
-                start_time = SDL_GetTicks();
-            }
-
-            if (snake_cells[0].x == apple.x && snake_cells[0].y == apple.y) {
-                grow_snake(snake_cells, snake_length);
-                snake_length++;
-                apple = spawn_apple(snake_cells, snake_length, cell_x, cell_y);
-            }
-            draw_grid(HMM_V2((float)window_width, (float)window_height), cell_size, grid_texture, projection);
-
-            HMM_Vec2 cell_dim = HMM_V2(cell_size, cell_size);
-
-            draw_quad(HMM_V2(apple.x * cell_size, apple.y * cell_size), cell_dim, (f32)SDL_GetTicks() * 0.1f, projection, apple_texture);
-
-            for (int i = 0; i < snake_length; i++) {
-                f32 rot = 0.0f;
-                HMM_Vec2 pos = HMM_V2(snake_cells[i].x * cell_size, snake_cells[i].y * cell_size);
-                draw_quad(pos, cell_dim, rot, projection, cell_texture);
             }
-
-            char buffer[12]{};
-            sprintf(buffer, "%d", snake_length);
-            draw_text((const char *)buffer, HMM_V2(0.0f, 0.0f), 30.0f, font_texture, projection);
-        } else if (game_state.game_mode == Mode_End) {
-            draw_text("GAME OVER", HMM_V2(400.0f, 600.0f), 40.0f, font_texture, projection);
         }
+        state.sim_ns = profile_now_ns() - sim_start;
+
+        // Events that change nothing on screen, like mouse motion, publish
+        // nothing and leave the render thread asleep.
+        b32 ticked = game.ticks != published_ticks;
+        if (ticked || game_mode != state.mode) {
+            state.trail = trail;
+            state.tick_counter = counter - accumulator;
+        }
+        state.mode = game_mode;
+        state.start_selected = start_selected;
+        state.exit_selected = exit_selected;
+        if (ticked || frame_changed(&state, &published)) {
+            publish_frame(&render, &state, &game);
+            published = state;
+            published_ticks = game.ticks;
+        }
+    }
+
+    render.quit = true;
+    render_wake(&render);
+    render.thread.join();
+    snapshot_pool_free(&render.games);
 
-        SDL_GL_SwapWindow(window);
+    // A game abandoned by closing the window is still worth keeping.
+    if (record_path && !recording_saved) {
+        replay_finish(&recording, &game);
+        replay_write_file(&recording, record_path, false);
     }
+    replay_writer_free(&recording);
+    autopilot_free(&autopilot);
+    replay_close(&replay_file);
+
+    arena_report("Board", &game.board_arena);
+    arena_report("Snake", &game.snake_arena);
+    game_free(&game);
 
     SDL_DestroyWindow(window);
     SDL_Quit();
-    return 0;
+    return render.failed ? -1 : 0;
 }
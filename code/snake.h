@@ -13,20 +13,11 @@ struct Menu {
     MenuItem *selected;
 };
 
-struct Snake {
-    struct Cell *cells;
-    int length;
-};
-
 enum GameMode {
     Mode_Start,
     Mode_Play,
     Mode_End,
-};
-
-struct GameState {
-    GameMode game_mode;
-    Snake *snake;
+    Mode_Won,
 };
 
 struct Input {
@@ -36,41 +27,32 @@ struct Input {
     b32 right;
     b32 enter;
 };
-   
-enum Dir {
-    Left = 1,
-    Right,
-    Up,
-    Down,
-};
 
-struct Cell {
-    int x;
-    int y;
-    Dir dir;
-
-    Cell() {
-        x = 0;
-        y = 0;
-        dir = (Dir)0;
-    }
-    
-    Cell(int x, int y) {
-        this->x = x;
-        this->y = y;
-        dir = (Dir)0;
-    }
-
-    Cell(int x, int y, Dir dir) {
-        this->x = x;
-        this->y = y;
-        this->dir = dir;
-    }
-};
-
-struct QuadV {
-    f32 x, y;
-    f32 u, v;
+// Everything the render thread needs to draw a frame, written whole by the
+// sim thread and handed over through a Handoff. In play the board goes in
+// the game snapshot slot with the same index.
+struct FrameState {
+    GameMode mode;
+    b32 start_selected;
+    b32 exit_selected;
+    b32 show_profiler;
+
+    int window_width;
+    int window_height;
+    b32 window_visible;
+    b32 window_focused;
+    f32 cell_size;
+
+    // The snake is drawn part way from trail to the snapshot by how far the
+    // render clock is past tick_counter, the performance counter when the
+    // last tick was due.
+    SnakeTrail trail;
+    u64 tick_counter;
+    u64 tick_counts;
+
+    // Zone times from the sim thread, which has no profiler of its own.
+    u64 events_ns;
+    u64 sim_ns;
 };
 
 #endif // SNAKE_H
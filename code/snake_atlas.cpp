@@ -0,0 +1,164 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snake_atlas.h"
+#include "snake_sim.h"
+
+#define ATLAS_WIDTH 512
+#define ATLAS_PADDING 1
+#define PACK_ALIGNMENT 64
+
+const char *sprite_paths[Sprite_Count] = {
+    "data/arrow.png",
+    "data/cell.png",
+    "data/apple.png",
+    "data/grid.png",
+    "data/font.png",
+    "data/head.png",
+    "data/body.png",
+    "data/tail.png",
+    "data/corner.png",
+    "data/snake.png",
+};
+
+struct AtlasImage {
+    int width;
+    int height;
+    u8 *pixels;
+};
+
+// Packs tallest first into rows across a fixed width, then rounds the
+// height up to a power of two.
+b32 atlas_build(Atlas *atlas) {
+    *atlas = {};
+    AtlasImage images[Sprite_Count];
+    b32 loaded = true;
+    stbi_set_flip_vertically_on_load(true);
+    for (int i = 0; i < Sprite_Count; i++) {
+        int n;
+        images[i].pixels = stbi_load(sprite_paths[i], &images[i].width, &images[i].height, &n, 4);
+        if (images[i].pixels == NULL) {
+            printf("Failed to load texture: %s\n", sprite_paths[i]);
+            images[i].width = 1;
+            images[i].height = 1;
+            loaded = false;
+        }
+    }
+
+    int order[Sprite_Count];
+    for (int i = 0; i < Sprite_Count; i++) {
+        int j = i;
+        while (j > 0 && images[order[j - 1]].height < images[i].height) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    int x = 0, y = 0, row_height = 0;
+    for (int i = 0; i < Sprite_Count; i++) {
+        AtlasImage *image = &images[order[i]];
+        if (x + image->width > ATLAS_WIDTH) {
+            x = 0;
+            y += row_height + ATLAS_PADDING;
+            row_height = 0;
+        }
+        AtlasRect *rect = &atlas->rects[order[i]];
+        rect->x = (u16)x;
+        rect->y = (u16)y;
+        rect->w = (u16)image->width;
+        rect->h = (u16)image->height;
+        x += image->width + ATLAS_PADDING;
+        if (image->height > row_height) row_height = image->height;
+    }
+
+    atlas->width = ATLAS_WIDTH;
+    atlas->height = 1;
+    while (atlas->height < y + row_height) {
+        atlas->height *= 2;
+    }
+    atlas->pixels = (u8 *)calloc((size_t)atlas->width * atlas->height, 4);
+    for (int i = 0; i < Sprite_Count; i++) {
+        AtlasRect *rect = &atlas->rects[i];
+        if (images[i].pixels) {
+            for (int row = 0; row < rect->h; row++) {
+                memcpy(atlas->pixels + ((size_t)(rect->y + row) * atlas->width + rect->x) * 4,
+                       images[i].pixels + (size_t)row * rect->w * 4, rect->w * 4);
+            }
+            stbi_image_free(images[i].pixels);
+        }
+    }
+
+    atlas->repeat_mask = 1u << Sprite_Grid;
+    return loaded;
+}
+
+void atlas_free(Atlas *atlas) {
+    if (atlas->mapping) {
+        platform_unmap_file(atlas->mapping, atlas->mapping_size);
+    } else {
+        free(atlas->pixels);
+    }
+    *atlas = {};
+}
+
+// The pixels start on a cache line so the upload reads them straight out
+// of the mapping.
+b32 atlas_write_pack(Atlas *atlas, const char *path) {
+    PackHeader header{};
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.sprite_count = Sprite_Count;
+    header.width = atlas->width;
+    header.height = atlas->height;
+    header.repeat_mask = atlas->repeat_mask;
+    header.pixels_offset = (sizeof(header) + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+    memcpy(header.rects, atlas->rects, sizeof(header.rects));
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("Failed to write pack file: %s\n", path);
+        return false;
+    }
+    u8 padding[PACK_ALIGNMENT] = {};
+    u64 pixels_size = (u64)atlas->width * atlas->height * 4;
+    b32 written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(padding, header.pixels_offset - sizeof(header), 1, file) == 1 &&
+                  fwrite(atlas->pixels, pixels_size, 1, file) == 1;
+    fclose(file);
+    if (!written) printf("Failed to write pack file: %s\n", path);
+    return written;
+}
+
+b32 atlas_load_pack(Atlas *atlas, const char *path) {
+    *atlas = {};
+    u64 size;
+    const u8 *data = (const u8 *)platform_map_file(path, &size);
+    if (data == NULL) return false;
+
+    PackHeader header;
+    b32 valid = size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, data, sizeof(header));
+        valid = header.magic == PACK_MAGIC && header.version == PACK_VERSION && header.sprite_count == Sprite_Count &&
+                header.pixels_offset + (u64)header.width * header.height * 4 <= size;
+    }
+    if (!valid) {
+        printf("Ignoring stale or damaged pack file: %s\n", path);
+        platform_unmap_file(data, size);
+        return false;
+    }
+
+    atlas->width = header.width;
+    atlas->height = header.height;
+    atlas->pixels = (u8 *)(data + header.pixels_offset);
+    atlas->repeat_mask = header.repeat_mask;
+    memcpy(atlas->rects, header.rects, sizeof(atlas->rects));
+    atlas->mapping = data;
+    atlas->mapping_size = size;
+    return true;
+}
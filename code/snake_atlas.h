@@ -0,0 +1,73 @@
+#ifndef SNAKE_ATLAS_H
+#define SNAKE_ATLAS_H
+
+// Every sprite and the font strip packed into one RGBA image, with a rect
+// per sprite id. Building the atlas needs no GL, so tools can pack it too.
+//
+// snake_bake writes the built atlas to a pack file: a PackHeader followed
+// by the pixels, bottom row first and ready for glTexImage2D. Loading a pack
+// maps the file and points the atlas at it, so startup decodes no PNGs.
+
+#include "snake_base.h"
+
+#define PACK_MAGIC 0x504B4E53 // "SNKP"
+#define PACK_VERSION 1
+#define PACK_PATH "data/sprites.pack"
+
+enum SpriteId {
+    Sprite_Arrow,
+    Sprite_Cell,
+    Sprite_Apple,
+    Sprite_Grid,
+    Sprite_Font,
+    Sprite_Head,
+    Sprite_Body,
+    Sprite_Tail,
+    Sprite_Corner,
+    Sprite_Snake,
+    Sprite_Count,
+};
+
+// Rects are in texels with the origin at the bottom left, as GL sees the
+// image.
+struct AtlasRect {
+    u16 x, y;
+    u16 w, h;
+};
+
+struct Atlas {
+    int width;
+    int height;
+    u8 *pixels;
+    AtlasRect rects[Sprite_Count];
+    u32 repeat_mask;  // bit per sprite id that tiles instead of clamping
+
+    // Set when pixels point into a mapped pack file.
+    const void *mapping;
+    u64 mapping_size;
+};
+
+struct PackHeader {
+    u32 magic;
+    u16 version;
+    u16 sprite_count;
+    u32 width;
+    u32 height;
+    u32 repeat_mask;
+    u32 pixels_offset;
+    AtlasRect rects[Sprite_Count];
+};
+
+extern const char *sprite_paths[Sprite_Count];
+
+// Loads every file in sprite_paths and packs them into rows. Returns false
+// if any file fails to load.
+b32 atlas_build(Atlas *atlas);
+void atlas_free(Atlas *atlas);
+
+b32 atlas_write_pack(Atlas *atlas, const char *path);
+// Fails quietly if the pack is missing, so callers can fall back to
+// atlas_build; a pack from another version or sprite set is reported.
+b32 atlas_load_pack(Atlas *atlas, const char *path);
+
+#endif // SNAKE_ATLAS_H
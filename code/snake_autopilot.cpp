@@ -0,0 +1,220 @@
+#include "snake_autopilot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#define AUTOPILOT_BUDGET_NS 2000000
+#define AUTOPILOT_CLOCK_INTERVAL 1024
+
+static const int dir_dx[] = {0, -1, 1, 0, 0};
+static const int dir_dy[] = {0, 0, 0, 1, -1};
+
+void autopilot_create(Autopilot *autopilot, int width, int height) {
+    *autopilot = {};
+    autopilot->width = width;
+    autopilot->height = height;
+    autopilot->budget_ns = AUTOPILOT_BUDGET_NS;
+
+    u64 cells = (u64)width * height;
+    // Every cell can be pushed once per improving neighbour, so four times
+    // the board is enough for the open set.
+    autopilot->heap_capacity = (int)(4 * cells + 4);
+    autopilot->arena = arena_create(cells * (5 * sizeof(u32) + sizeof(s32)) + autopilot->heap_capacity * sizeof(u64) + 1024);
+
+    MemoryArena *arena = &autopilot->arena;
+    autopilot->stamp = (u32 *)arena_push(arena, cells * sizeof(u32));
+    autopilot->cost = (u32 *)arena_push(arena, cells * sizeof(u32));
+    autopilot->came_from = (s32 *)arena_push(arena, cells * sizeof(s32));
+    autopilot->heap = (u64 *)arena_push(arena, autopilot->heap_capacity * sizeof(u64));
+    autopilot->flood_stamp = (u32 *)arena_push(arena, cells * sizeof(u32));
+    autopilot->flood_stack = (s32 *)arena_push(arena, cells * sizeof(s32));
+}
+
+void autopilot_free(Autopilot *autopilot) {
+    arena_release(&autopilot->arena);
+    *autopilot = {};
+}
+
+static void heap_push(Autopilot *autopilot, u64 value) {
+    u64 *heap = autopilot->heap;
+    int i = autopilot->heap_count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent] <= value) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = value;
+}
+
+static u64 heap_pop(Autopilot *autopilot) {
+    u64 *heap = autopilot->heap;
+    u64 result = heap[0];
+    u64 last = heap[--autopilot->heap_count];
+    int count = autopilot->heap_count;
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= count) break;
+        if (child + 1 < count && heap[child + 1] < heap[child]) child++;
+        if (last <= heap[child]) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (count > 0) heap[i] = last;
+    return result;
+}
+
+static u32 next_generation(u32 *generation, u32 *stamps, u64 cells) {
+    if (++*generation == 0) {
+        memset(stamps, 0, cells * sizeof(u32));
+        *generation = 1;
+    }
+    return *generation;
+}
+
+// A cell is blocked if the body covers it, except for the tail, which will
+// have moved on by the time the head could get there.
+inline b32 cell_blocked(Board *board, int x, int y, int tail) {
+    if (x < 0 || x >= board->width || y < 0 || y >= board->height) return true;
+    return board_test(board, x, y) && y * board->width + x != tail;
+}
+
+// Counts the free cells reachable from cell start once the head has moved
+// there, stopping as soon as limit is reached.
+static int flood_count(Autopilot *autopilot, Board *board, int start, int tail, int limit) {
+    u32 generation = next_generation(&autopilot->flood_generation, autopilot->flood_stamp, (u64)board->width * board->height);
+    s32 *stack = autopilot->flood_stack;
+    int top = 0;
+    int count = 0;
+
+    autopilot->flood_stamp[start] = generation;
+    stack[top++] = start;
+    while (top > 0 && count < limit) {
+        int cell = stack[--top];
+        int x = cell % board->width;
+        int y = cell / board->width;
+        for (int dir = Left; dir <= Down; dir++) {
+            int nx = x + dir_dx[dir];
+            int ny = y + dir_dy[dir];
+            if (cell_blocked(board, nx, ny, tail)) continue;
+            int next = ny * board->width + nx;
+            if (autopilot->flood_stamp[next] == generation) continue;
+            autopilot->flood_stamp[next] = generation;
+            stack[top++] = next;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Returns the first move on the shortest path to the apple, or on the path
+// to the cell closest to it if the budget ran out. Returns 0 if the head is
+// boxed in.
+static Dir astar_first_move(Autopilot *autopilot, GameState *state, int tail) {
+    Board *board = &state->board;
+    int width = board->width;
+    Cell *head = snake_cell(&state->snake, 0);
+    int start = head->y * width + head->x;
+    int goal = state->apple.y * width + state->apple.x;
+
+    u32 generation = next_generation(&autopilot->generation, autopilot->stamp, (u64)width * board->height);
+    autopilot->heap_count = 0;
+    autopilot->expansions = 0;
+    autopilot->out_of_budget = false;
+
+    auto start_time = std::chrono::steady_clock::now();
+    int best = start;
+    u32 best_h = (u32)(abs(head->x - state->apple.x) + abs(head->y - state->apple.y));
+
+    autopilot->stamp[start] = generation;
+    autopilot->cost[start] = 0;
+    autopilot->came_from[start] = -1;
+    heap_push(autopilot, ((u64)best_h << 32) | (u32)start);
+
+    while (autopilot->heap_count > 0) {
+        u64 top = heap_pop(autopilot);
+        int cell = (int)(u32)top;
+        int x = cell % width;
+        int y = cell / width;
+        u32 g = autopilot->cost[cell];
+        u32 h = (u32)(abs(x - state->apple.x) + abs(y - state->apple.y));
+        if ((u32)(top >> 32) != g + h) continue; // stale entry
+
+        if (h < best_h) {
+            best_h = h;
+            best = cell;
+        }
+        if (cell == goal) break;
+
+        if (++autopilot->expansions % AUTOPILOT_CLOCK_INTERVAL == 0 && autopilot->budget_ns) {
+            u64 elapsed = (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+            if (elapsed >= autopilot->budget_ns) {
+                autopilot->out_of_budget = true;
+                break;
+            }
+        }
+
+        for (int dir = Left; dir <= Down; dir++) {
+            int nx = x + dir_dx[dir];
+            int ny = y + dir_dy[dir];
+            if (cell_blocked(board, nx, ny, tail)) continue;
+            int next = ny * width + nx;
+            if (cell == start && (Dir)dir == dir_opposite(state->dir)) continue;
+            if (autopilot->stamp[next] == generation && autopilot->cost[next] <= g + 1) continue;
+
+            autopilot->stamp[next] = generation;
+            autopilot->cost[next] = g + 1;
+            autopilot->came_from[next] = cell;
+            u32 f = g + 1 + (u32)(abs(nx - state->apple.x) + abs(ny - state->apple.y));
+            if (autopilot->heap_count < autopilot->heap_capacity) {
+                heap_push(autopilot, ((u64)f << 32) | (u32)next);
+            }
+        }
+    }
+
+    if (best == start) return (Dir)0;
+    int step = best;
+    while (autopilot->came_from[step] != start) {
+        step = autopilot->came_from[step];
+    }
+    int dx = step % width - head->x;
+    int dy = step / width - head->y;
+    return dx < 0 ? Left : dx > 0 ? Right : dy > 0 ? Up : Down;
+}
+
+Dir autopilot_choose(Autopilot *autopilot, GameState *state) {
+    Board *board = &state->board;
+    Snake *snake = &state->snake;
+    Cell *head = snake_cell(snake, 0);
+    Cell *tail_cell = snake_cell(snake, snake->length - 1);
+    int tail = tail_cell->y * board->width + tail_cell->x;
+
+    Dir move = astar_first_move(autopilot, state, tail);
+    if (move) {
+        int x = head->x + dir_dx[move];
+        int y = head->y + dir_dy[move];
+        b32 eats = x == state->apple.x && y == state->apple.y;
+        int room = flood_count(autopilot, board, y * board->width + x, eats ? -1 : tail, snake->length);
+        if (room >= snake->length) return move;
+    }
+
+    // No safe path: take the move that keeps the most room.
+    Dir best = state->dir;
+    int best_room = -1;
+    for (int dir = Left; dir <= Down; dir++) {
+        if ((Dir)dir == dir_opposite(state->dir)) continue;
+        int x = head->x + dir_dx[dir];
+        int y = head->y + dir_dy[dir];
+        if (cell_blocked(board, x, y, tail)) continue;
+        b32 eats = x == state->apple.x && y == state->apple.y;
+        int room = flood_count(autopilot, board, y * board->width + x, eats ? -1 : tail, board->width * board->height);
+        if (room > best_room) {
+            best_room = room;
+            best = (Dir)dir;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,43 @@
+#ifndef SNAKE_AUTOPILOT_H
+#define SNAKE_AUTOPILOT_H
+
+// Built-in bot. Each tick it runs A* from the head to the apple and takes
+// the first step of the path, unless that step would leave the head in a
+// region with fewer free cells than the body is long. In that case, or when
+// no path exists, it takes the move with the most room.
+//
+// All search memory is allocated once by autopilot_create. Cells are
+// stamped with a per-search generation instead of being cleared, so a
+// search only touches the cells it visits.
+
+#include "snake_sim.h"
+
+struct Autopilot {
+    int width;
+    int height;
+
+    u32 generation;
+    u32 *stamp;      // generation that last touched each cell
+    u32 *cost;       // steps from the head
+    s32 *came_from;  // previous cell on the best path
+
+    u64 *heap;       // open set, (f << 32 | cell)
+    int heap_count;
+    int heap_capacity;
+
+    u32 flood_generation;
+    u32 *flood_stamp;
+    s32 *flood_stack;
+
+    u64 budget_ns;       // per-tick time budget, 0 for none
+    u64 expansions;      // nodes expanded by the last search
+    b32 out_of_budget;   // the last search was cut short
+
+    MemoryArena arena;
+};
+
+void autopilot_create(Autopilot *autopilot, int width, int height);
+void autopilot_free(Autopilot *autopilot);
+Dir autopilot_choose(Autopilot *autopilot, GameState *state);
+
+#endif // SNAKE_AUTOPILOT_H
@@ -0,0 +1,21 @@
+#include <stdio.h>
+
+#include "snake_atlas.h"
+
+// snake_bake [pack path]
+// Run from the repository root, as sprite_paths are relative to it.
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : PACK_PATH;
+
+    Atlas atlas;
+    if (!atlas_build(&atlas)) {
+        atlas_free(&atlas);
+        return 1;
+    }
+    b32 written = atlas_write_pack(&atlas, path);
+    if (written) {
+        printf("%s: %dx%d atlas, %d sprites\n", path, atlas.width, atlas.height, (int)Sprite_Count);
+    }
+    atlas_free(&atlas);
+    return written ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+#include "snake_batch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BATCH_SSE2
+#endif
+
+void batch_init(GameBatch *batch, int count, int width, int height, u64 seed) {
+    *batch = {};
+    batch->count = count;
+    batch->lane_count = (count + BATCH_LANES - 1) & ~(BATCH_LANES - 1);
+    batch->width = width;
+    batch->height = height;
+
+    int body_capacity = 1;
+    while (body_capacity < width * height) {
+        body_capacity *= 2;
+    }
+    batch->body_mask = body_capacity - 1;
+
+    u64 lanes = (u64)batch->lane_count;
+    u64 board_size = board_storage_size(width, height);
+    u64 reserve = lanes * (10 * sizeof(s32) + 16 + sizeof(Rng)) + lanes * body_capacity * sizeof(u32) +
+                  lanes * (sizeof(Board) + board_size) + 1024;
+    batch->arena = arena_create(reserve);
+
+    MemoryArena *arena = &batch->arena;
+    batch->head_x = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->head_y = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->dir = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->length = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->apple_x = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->apple_y = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->event = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->body_head = (s32 *)arena_push(arena, lanes * sizeof(s32));
+    batch->ticks = (u32 *)arena_push(arena, lanes * sizeof(u32));
+    batch->done = (u8 *)arena_push(arena, lanes);
+    batch->rng = (Rng *)arena_push(arena, lanes * sizeof(Rng));
+    batch->body = (u32 *)arena_push(arena, lanes * body_capacity * sizeof(u32));
+    batch->boards = (Board *)arena_push(arena, lanes * sizeof(Board));
+
+    Rng streams;
+    rng_seed(&streams, seed);
+    for (int lane = 0; lane < count; lane++) {
+        batch->rng[lane] = rng_split(&streams);
+        batch->boards[lane] = board_create(arena, width, height);
+        batch->length[lane] = 0;
+        batch_reset_lane(batch, lane);
+    }
+}
+
+// Games under a random policy last a few dozen ticks, so clearing the
+// whole board every time costs more than the game did. Only the body's
+// cells are handed back instead; a tail already vacated by the fatal move
+// is skipped.
+void batch_reset_lane(GameBatch *batch, int lane) {
+    Board *board = &batch->boards[lane];
+    u32 *body = batch->body + (u64)lane * (batch->body_mask + 1);
+    for (int i = 0; i < batch->length[lane]; i++) {
+        u32 cell = body[(batch->body_head[lane] - i) & batch->body_mask];
+        s32 x = cell % batch->width;
+        s32 y = cell / batch->width;
+        if (board_test(board, x, y)) board_vacate(board, x, y);
+    }
+
+    int start_y = batch->height > 4 ? 4 : 0;
+    batch->head_x[lane] = 0;
+    batch->head_y[lane] = start_y;
+    batch->dir[lane] = Right;
+    batch->length[lane] = 1;
+    batch->body_head[lane] = 0;
+    batch->body[(u64)lane * (batch->body_mask + 1)] = start_y * batch->width;
+    batch->ticks[lane] = 0;
+    board_occupy(board, 0, start_y);
+
+    Cell apple{};
+    spawn_apple(board, &batch->rng[lane], &apple);
+    batch->apple_x[lane] = apple.x;
+    batch->apple_y[lane] = apple.y;
+}
+
+// Applies turns, moves every head and flags wall hits and eaten apples in
+// event[]. Directions are encoded so the opposite of d is ((d - 1) ^ 1) + 1.
+static void batch_move_lanes(GameBatch *batch, const s32 *turns) {
+    int lane = 0;
+#if defined(__AVX2__)
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i two = _mm256_set1_epi32(2);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i max_x = _mm256_set1_epi32(batch->width - 1);
+    __m256i max_y = _mm256_set1_epi32(batch->height - 1);
+    for (; lane < batch->lane_count; lane += 8) {
+        __m256i dir = _mm256_loadu_si256((__m256i *)(batch->dir + lane));
+        if (turns) {
+            __m256i turn = _mm256_loadu_si256((__m256i *)(turns + lane));
+            __m256i opposite = _mm256_add_epi32(_mm256_xor_si256(_mm256_sub_epi32(dir, one), one), one);
+            __m256i keep = _mm256_or_si256(_mm256_cmpeq_epi32(turn, zero), _mm256_cmpeq_epi32(turn, opposite));
+            dir = _mm256_blendv_epi8(turn, dir, keep);
+            _mm256_storeu_si256((__m256i *)(batch->dir + lane), dir);
+        }
+
+        __m256i dx = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, one), _mm256_cmpeq_epi32(dir, two));
+        __m256i dy = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, _mm256_set1_epi32(Down)), _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(Up)));
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256((__m256i *)(batch->head_x + lane)), dx);
+        __m256i y = _mm256_add_epi32(_mm256_loadu_si256((__m256i *)(batch->head_y + lane)), dy);
+
+        __m256i wall = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(zero, x), _mm256_cmpgt_epi32(x, max_x)),
+                                       _mm256_or_si256(_mm256_cmpgt_epi32(zero, y), _mm256_cmpgt_epi32(y, max_y)));
+        __m256i ate = _mm256_and_si256(_mm256_cmpeq_epi32(x, _mm256_loadu_si256((__m256i *)(batch->apple_x + lane))),
+                                       _mm256_cmpeq_epi32(y, _mm256_loadu_si256((__m256i *)(batch->apple_y + lane))));
+        __m256i event = _mm256_or_si256(_mm256_and_si256(wall, one), _mm256_and_si256(ate, two));
+
+        _mm256_storeu_si256((__m256i *)(batch->head_x + lane), x);
+        _mm256_storeu_si256((__m256i *)(batch->head_y + lane), y);
+        _mm256_storeu_si256((__m256i *)(batch->event + lane), event);
+    }
+#elif defined(BATCH_SSE2)
+    __m128i one = _mm_set1_epi32(1);
+    __m128i two = _mm_set1_epi32(2);
+    __m128i zero = _mm_setzero_si128();
+    __m128i max_x = _mm_set1_epi32(batch->width - 1);
+    __m128i max_y = _mm_set1_epi32(batch->height - 1);
+    for (; lane < batch->lane_count; lane += 4) {
+        __m128i dir = _mm_load_si128((__m128i *)(batch->dir + lane));
+        if (turns) {
+            __m128i turn = _mm_loadu_si128((__m128i *)(turns + lane));
+            __m128i opposite = _mm_add_epi32(_mm_xor_si128(_mm_sub_epi32(dir, one), one), one);
+            __m128i keep = _mm_or_si128(_mm_cmpeq_epi32(turn, zero), _mm_cmpeq_epi32(turn, opposite));
+            dir = _mm_or_si128(_mm_and_si128(keep, dir), _mm_andnot_si128(keep, turn));
+            _mm_store_si128((__m128i *)(batch->dir + lane), dir);
+        }
+
+        __m128i dx = _mm_sub_epi32(_mm_cmpeq_epi32(dir, one), _mm_cmpeq_epi32(dir, two));
+        __m128i dy = _mm_sub_epi32(_mm_cmpeq_epi32(dir, _mm_set1_epi32(Down)), _mm_cmpeq_epi32(dir, _mm_set1_epi32(Up)));
+        __m128i x = _mm_add_epi32(_mm_load_si128((__m128i *)(batch->head_x + lane)), dx);
+        __m128i y = _mm_add_epi32(_mm_load_si128((__m128i *)(batch->head_y + lane)), dy);
+
+        __m128i wall = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(x, zero), _mm_cmpgt_epi32(x, max_x)),
+                                    _mm_or_si128(_mm_cmplt_epi32(y, zero), _mm_cmpgt_epi32(y, max_y)));
+        __m128i ate = _mm_and_si128(_mm_cmpeq_epi32(x, _mm_load_si128((__m128i *)(batch->apple_x + lane))),
+                                    _mm_cmpeq_epi32(y, _mm_load_si128((__m128i *)(batch->apple_y + lane))));
+        __m128i event = _mm_or_si128(_mm_and_si128(wall, one), _mm_and_si128(ate, two));
+
+        _mm_store_si128((__m128i *)(batch->head_x + lane), x);
+        _mm_store_si128((__m128i *)(batch->head_y + lane), y);
+        _mm_store_si128((__m128i *)(batch->event + lane), event);
+    }
+#endif
+    for (; lane < batch->lane_count; lane++) {
+        s32 dir = batch->dir[lane];
+        if (turns && turns[lane] && turns[lane] != ((dir - 1) ^ 1) + 1) {
+            dir = batch->dir[lane] = turns[lane];
+        }
+        s32 x = batch->head_x[lane] += (dir==Left) ? -1 : (dir==Right) ? 1 : 0;
+        s32 y = batch->head_y[lane] += (dir==Down) ? -1 : (dir==Up) ? 1 : 0;
+        b32 wall = x < 0 || x >= batch->width || y < 0 || y >= batch->height;
+        b32 ate = x == batch->apple_x[lane] && y == batch->apple_y[lane];
+        batch->event[lane] = (wall ? Batch_HitWall : 0) | (ate ? Batch_AteApple : 0);
+    }
+}
+
+static void batch_finish_lane(GameBatch *batch, int lane, b32 won) {
+    batch->games_finished++;
+    batch->games_won += won;
+    batch->total_length += batch->length[lane];
+    batch->total_ticks += batch->ticks[lane];
+    batch->done[lane] = true;
+    batch_reset_lane(batch, lane);
+}
+
+// turns holds one Dir per lane (0 keeps going) and may be NULL. It must
+// have lane_count entries.
+void batch_step(GameBatch *batch, const s32 *turns) {
+    batch_move_lanes(batch, turns);
+
+    for (int lane = 0; lane < batch->count; lane++) {
+        s32 event = batch->event[lane];
+        batch->done[lane] = false;
+        batch->ticks[lane]++;
+        if (event & Batch_HitWall) {
+            batch_finish_lane(batch, lane, false);
+            continue;
+        }
+
+        Board *board = &batch->boards[lane];
+        u32 *body = batch->body + (u64)lane * (batch->body_mask + 1);
+        s32 x = batch->head_x[lane];
+        s32 y = batch->head_y[lane];
+        b32 ate_apple = event & Batch_AteApple;
+        // The tail leaves its cell before the test, as in game_step, so the
+        // head may follow it. The length only changes once the move stands,
+        // so a body death counts the full snake.
+        if (!ate_apple) {
+            u32 tail = body[(batch->body_head[lane] - (batch->length[lane] - 1)) & batch->body_mask];
+            board_vacate(board, tail % batch->width, tail / batch->width);
+        }
+        if (board_test(board, x, y)) {
+            batch_finish_lane(batch, lane, false);
+            continue;
+        }
+
+        s32 head = (batch->body_head[lane] + 1) & batch->body_mask;
+        body[head] = y * batch->width + x;
+        batch->body_head[lane] = head;
+        if (ate_apple) batch->length[lane]++;
+        board_occupy(board, x, y);
+
+        if (ate_apple) {
+            Cell apple{};
+            if (!spawn_apple(board, &batch->rng[lane], &apple)) {
+                batch_finish_lane(batch, lane, true);
+                continue;
+            }
+            batch->apple_x[lane] = apple.x;
+            batch->apple_y[lane] = apple.y;
+        }
+    }
+}
+
+void batch_free(GameBatch *batch) {
+    arena_release(&batch->arena);
+    *batch = {};
+}
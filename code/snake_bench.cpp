@@ -0,0 +1,692 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "snake_sim.h"
+#include "snake_autopilot.h"
+
+#if !defined(BENCH_NO_GL)
+#include "snake_render.h"
+#if defined(_WIN32)
+#include <SDL.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#endif
+
+// snake_bench [--json PATH] [--baseline PATH] [--threshold PCT] [--filter TEXT] [--no-gl] [--quick]
+//
+// Times the simulation hot paths and the GL draw calls, prints one line per
+// benchmark and optionally writes them as JSON. With --baseline the results
+// are compared against an earlier JSON file and the exit code is 1 if any
+// benchmark got slower by more than the threshold.
+//
+// The timings are absolute, so a baseline only means something on the
+// machine and with the flags it was made with. None is checked in; make one
+// locally before a change and compare after it, from the repo root:
+//
+//     build/snake_bench --quick --json /tmp/before.json
+//     build/snake_bench --quick --baseline /tmp/before.json
+
+struct BenchResult {
+    char name[96];
+    f64 ns_per_op;
+    u64 iterations;
+};
+
+struct Bench {
+    std::vector<BenchResult> results;
+    const char *filter;
+    b32 quick;
+    b32 gl;
+};
+
+// Results are added in here so the timed loops cannot be optimized away.
+static volatile s64 bench_sink;
+
+static u64 now_ns() {
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static b32 bench_wanted(Bench *bench, const char *name) {
+    return bench->filter == NULL || strstr(name, bench->filter) != NULL;
+}
+
+static void bench_report(Bench *bench, const char *name, f64 ns_per_op, u64 iterations) {
+    BenchResult result{};
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    result.ns_per_op = ns_per_op;
+    result.iterations = iterations;
+    bench->results.push_back(result);
+    printf("%-40s %12.2f ns/op %10llu ops\n", name, ns_per_op, (unsigned long long)iterations);
+}
+
+static f64 median(f64 *values, int count) {
+    std::sort(values, values + count);
+    return values[count / 2];
+}
+
+//
+// Simulation
+//
+
+#define BENCH_BOARD_WIDTH 1024
+#define BENCH_REPEATS 5
+
+// Cell i of a boustrophedon walk over the board, so a body of any length
+// can be laid out and moved along without running into itself.
+static Cell serpentine_cell(int index, int width) {
+    int y = index / width;
+    int x = (y & 1) ? width - 1 - index % width : index % width;
+    return Cell(x, y);
+}
+
+static Dir serpentine_dir(int index, int width) {
+    Cell from = serpentine_cell(index, width);
+    Cell to = serpentine_cell(index + 1, width);
+    if (to.y != from.y) return Up;
+    return to.x > from.x ? Right : Left;
+}
+
+// Lays a snake of the given length along the walk, head last.
+static void lay_snake(GameState *state, int length) {
+    board_reset(&state->board);
+    snake_reset(&state->snake);
+    snake_reserve(&state->snake, length);
+    int width = state->board.width;
+    for (int i = 0; i < length; i++) {
+        Cell cell = serpentine_cell(i, width);
+        cell.dir = serpentine_dir(i, width);
+        snake_push_head(&state->snake, cell);
+        board_occupy(&state->board, cell.x, cell.y);
+    }
+    state->dir = serpentine_dir(length - 1, width);
+    state->status = Game_Playing;
+}
+
+static void bench_snake_length(Bench *bench, int length, int steps) {
+    char step_name[96], grow_name[96], scan_name[96], bitmap_name[96];
+    snprintf(step_name, sizeof(step_name), "sim/snake_step/len=%d", length);
+    snprintf(grow_name, sizeof(grow_name), "sim/grow_snake/len=%d", length);
+    snprintf(scan_name, sizeof(scan_name), "sim/death_check_scan/len=%d", length);
+    snprintf(bitmap_name, sizeof(bitmap_name), "sim/death_check_bitmap/len=%d", length);
+    if (!bench_wanted(bench, step_name) && !bench_wanted(bench, grow_name) &&
+        !bench_wanted(bench, scan_name) && !bench_wanted(bench, bitmap_name)) {
+        return;
+    }
+
+    int width = BENCH_BOARD_WIDTH;
+    int height = (length + steps) / width + 2;
+    GameState state;
+    game_init(&state, width, height, 1);
+    f64 samples[BENCH_REPEATS];
+
+    // A tick without growth: push a head, pop the tail, update occupancy.
+    if (bench_wanted(bench, step_name)) {
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            lay_snake(&state, length);
+            u64 start = now_ns();
+            for (int i = 0; i < steps; i++) {
+                snake_step(&state.snake, &state.board, serpentine_dir(length - 1 + i, width), false);
+            }
+            samples[r] = (f64)(now_ns() - start) / steps;
+        }
+        bench_report(bench, step_name, median(samples, BENCH_REPEATS), steps);
+    }
+
+    // An apple every tick, so the ring keeps doubling as it fills.
+    if (bench_wanted(bench, grow_name)) {
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            lay_snake(&state, length);
+            u64 start = now_ns();
+            for (int i = 0; i < steps; i++) {
+                snake_step(&state.snake, &state.board, serpentine_dir(length - 1 + i, width), true);
+            }
+            samples[r] = (f64)(now_ns() - start) / steps;
+        }
+        bench_report(bench, grow_name, median(samples, BENCH_REPEATS), steps);
+    }
+
+    // The collision test the game used to run, a walk over the whole body,
+    // against the single bit test it runs now.
+    lay_snake(&state, length);
+    Cell next = snake_next_head(&state.snake, state.dir);
+    if (bench_wanted(bench, scan_name)) {
+        int checks = (int)std::max<s64>(16, 20000000 / length);
+        if (bench->quick) checks = std::max(1, checks / 10);
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            int hits = 0;
+            u64 start = now_ns();
+            for (int c = 0; c < checks; c++) {
+                for (int i = 0; i < state.snake.length; i++) {
+                    Cell *cell = snake_cell(&state.snake, i);
+                    if (cell->x == next.x && cell->y == next.y + (c & 1)) {
+                        hits++;
+                        break;
+                    }
+                }
+            }
+            samples[r] = (f64)(now_ns() - start) / checks;
+            bench_sink += hits;
+        }
+        bench_report(bench, scan_name, median(samples, BENCH_REPEATS), checks);
+    }
+    if (bench_wanted(bench, bitmap_name)) {
+        int checks = bench->quick ? 1000000 : 10000000;
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            int hits = 0;
+            u64 start = now_ns();
+            for (int c = 0; c < checks; c++) {
+                hits += board_test(&state.board, next.x, next.y + (c & 1));
+            }
+            samples[r] = (f64)(now_ns() - start) / checks;
+            bench_sink += hits;
+        }
+        bench_report(bench, bitmap_name, median(samples, BENCH_REPEATS), checks);
+    }
+
+    game_free(&state);
+}
+
+static void bench_spawn(Bench *bench, int percent) {
+    char name[96];
+    snprintf(name, sizeof(name), "sim/spawn_apple/fill=%d%%", percent);
+    if (!bench_wanted(bench, name)) return;
+
+    int width = 256;
+    int height = 256;
+    GameState state;
+    game_init(&state, width, height, 1);
+    board_reset(&state.board);
+
+    // Occupy a random subset of the board.
+    int cells = width * height;
+    int fill = (int)((s64)cells * percent / 100);
+    std::vector<int> order(cells);
+    for (int i = 0; i < cells; i++) order[i] = i;
+    Rng rng;
+    rng_seed(&rng, 7);
+    for (int i = 0; i < fill; i++) {
+        int j = i + (int)rng_below(&rng, cells - i);
+        std::swap(order[i], order[j]);
+        board_occupy(&state.board, order[i] % width, order[i] / width);
+    }
+
+    int spawns = bench->quick ? 1000000 : 10000000;
+    f64 samples[BENCH_REPEATS];
+    Cell apple;
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        s64 sum = 0;
+        u64 start = now_ns();
+        for (int i = 0; i < spawns; i++) {
+            spawn_apple(&state.board, &rng, &apple);
+            sum += apple.x;
+        }
+        samples[r] = (f64)(now_ns() - start) / spawns;
+        bench_sink += sum;
+    }
+    bench_report(bench, name, median(samples, BENCH_REPEATS), spawns);
+    game_free(&state);
+}
+
+static void bench_sim(Bench *bench) {
+    int steps = bench->quick ? 20000 : 100000;
+    for (int length = 1; length <= 1000000; length *= 10) {
+        bench_snake_length(bench, length, steps);
+    }
+    const int fills[] = {0, 50, 90, 99};
+    for (int i = 0; i < (int)(sizeof(fills) / sizeof(fills[0])); i++) {
+        bench_spawn(bench, fills[i]);
+    }
+}
+
+//
+// Rendering
+//
+
+#if !defined(BENCH_NO_GL)
+
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+
+// A 1280x720 render target. On Linux this is a surfaceless Mesa context
+// with llvmpipe forced, so the numbers do not depend on the GPU driver.
+// Elsewhere it is a hidden SDL window; point the loader at Mesa's
+// opengl32.dll to get llvmpipe there too.
+static b32 bench_gl_init() {
+#if defined(_WIN32)
+    if (SDL_Init(SDL_INIT_VIDEO)) return false;
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_Window *window = SDL_CreateWindow("snake_bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                          BENCH_WIDTH, BENCH_HEIGHT, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+    if (window == NULL || SDL_GL_CreateContext(window) == NULL) return false;
+    SDL_GL_SetSwapInterval(0);
+    if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) return false;
+    gl_load_extensions(SDL_GL_GetProcAddress);
+#else
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+    setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = get_platform_display ?
+        get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) return false;
+    if (!eglBindAPI(EGL_OPENGL_API)) return false;
+
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) return false;
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) return false;
+    gl_load_extensions((GLADloadproc)eglGetProcAddress);
+
+    // No surface and so no default framebuffer: draw into our own.
+    u32 framebuffer, color;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, BENCH_WIDTH, BENCH_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) return false;
+#endif
+    glViewport(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+    printf("GL: %s\n", (const char *)glGetString(GL_RENDERER));
+    return true;
+}
+
+static HMM_Mat4 bench_projection() {
+    return HMM_Orthographic_RH_NO(0.0f, (f32)BENCH_WIDTH, 0.0f, (f32)BENCH_HEIGHT, -1.0f, 1.0f);
+}
+
+// Same per-frame state as the loop in main, which skips the clear when
+// draw_play copies in the background.
+static void frame_begin(b32 clear) {
+    gl_set_blend(true);
+    if (clear) {
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+}
+
+// Per-quad costs include the flush and glFinish, so they cover the upload
+// and the rasterizer as well as queueing.
+static void bench_sprites(Bench *bench) {
+    HMM_Mat4 projection = bench_projection();
+    int calls = bench->quick ? 2000 : 20000;
+    f64 samples[BENCH_REPEATS];
+
+    // count=1 flushes every quad, which is what a draw per quad costs.
+    const int batch_sizes[] = {1, 100, 10000};
+    for (int c = 0; c < (int)(sizeof(batch_sizes) / sizeof(batch_sizes[0])); c++) {
+        int count = batch_sizes[c];
+        char name[96];
+        snprintf(name, sizeof(name), "gl/sprites/batch=%d/per_quad", count);
+        if (!bench_wanted(bench, name)) continue;
+
+        int batches = calls / count + 1;
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            frame_begin(true);
+            glFinish();
+            u64 start = now_ns();
+            for (int i = 0; i < batches; i++) {
+                sprite_begin(projection);
+                for (int j = 0; j < count; j++) {
+                    HMM_Vec2 pos = HMM_V2((f32)(j % 35) * 36.0f, (f32)((j / 35) % 20) * 36.0f);
+                    push_quad(Layer_Sprites, pos, HMM_V2(36.0f, 36.0f), 0.0f, Sprite_Cell);
+                }
+                sprite_flush();
+            }
+            glFinish();
+            samples[r] = (f64)(now_ns() - start) / ((f64)batches * count);
+        }
+        bench_report(bench, name, median(samples, BENCH_REPEATS), (u64)batches * count);
+    }
+
+    // Each length is timed laid out every call and kept in a TextMesh, as
+    // the game does with fixed text.
+    const int text_lengths[] = {1, 16, 160};
+    for (int t = 0; t < (int)(sizeof(text_lengths) / sizeof(text_lengths[0])); t++) {
+        int length = text_lengths[t];
+        char text[256];
+        for (int i = 0; i < length; i++) text[i] = (char)('A' + i % 26);
+        text[length] = 0;
+        int text_calls = calls / length + 1;
+
+        TextMesh mesh{};
+        text_set(&mesh, text, HMM_V2(0.0f, 0.0f), 8.0f);
+        for (int retained = 0; retained < 2; retained++) {
+            char name[96];
+            snprintf(name, sizeof(name), "gl/%s/chars=%d/per_quad", retained ? "push_text_mesh" : "push_text", length);
+            if (!bench_wanted(bench, name)) continue;
+
+            for (int r = 0; r < BENCH_REPEATS; r++) {
+                frame_begin(true);
+                glFinish();
+                u64 start = now_ns();
+                sprite_begin(projection);
+                for (int i = 0; i < text_calls; i++) {
+                    if (retained) {
+                        push_text_mesh(Layer_Text, &mesh);
+                    } else {
+                        push_text(Layer_Text, text, HMM_V2(0.0f, (f32)(i % 20) * 30.0f), 8.0f);
+                    }
+                }
+                sprite_flush();
+                glFinish();
+                samples[r] = (f64)(now_ns() - start) / ((f64)text_calls * length);
+            }
+            bench_report(bench, name, median(samples, BENCH_REPEATS), (u64)text_calls * length);
+        }
+        text_free(&mesh);
+    }
+
+    if (bench_wanted(bench, "gl/push_grid")) {
+        int grid_calls = calls / 20;
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            frame_begin(true);
+            glFinish();
+            u64 start = now_ns();
+            for (int i = 0; i < grid_calls; i++) {
+                sprite_begin(projection);
+                push_grid(Layer_Board, HMM_V2((f32)BENCH_WIDTH, (f32)BENCH_HEIGHT), 36.0f);
+                sprite_flush();
+            }
+            glFinish();
+            samples[r] = (f64)(now_ns() - start) / grid_calls;
+        }
+        bench_report(bench, "gl/push_grid", median(samples, BENCH_REPEATS), grid_calls);
+    }
+}
+
+enum ScenarioKind {
+    Scenario_Menu,
+    Scenario_Fill,
+    Scenario_Autopilot,
+};
+
+struct Scenario {
+    const char *name;
+    ScenarioKind kind;
+    int cell_y;   // rows on screen, as CELL_Y in the game
+    int percent;  // board fill for Scenario_Fill
+};
+
+// Whole frames as the game draws them, glFinish included. The autopilot
+// scenario also steps the game every frame, as if every frame were a tick.
+static void bench_scenario(Bench *bench, Scenario *scenario) {
+    char name[96], p99_name[96];
+    snprintf(name, sizeof(name), "frame/%s/mean", scenario->name);
+    snprintf(p99_name, sizeof(p99_name), "frame/%s/p99", scenario->name);
+    if (!bench_wanted(bench, name) && !bench_wanted(bench, p99_name)) return;
+
+    HMM_Mat4 projection = bench_projection();
+    HMM_Vec2 window_dim = HMM_V2((f32)BENCH_WIDTH, (f32)BENCH_HEIGHT);
+    f32 cell_size = (f32)BENCH_HEIGHT / (f32)scenario->cell_y;
+    int cell_x = (int)(BENCH_WIDTH / cell_size);
+
+    GameState game;
+    game_init(&game, cell_x, scenario->cell_y, 1);
+    Autopilot autopilot;
+    autopilot_create(&autopilot, cell_x, scenario->cell_y);
+    if (scenario->kind == Scenario_Fill) {
+        int length = (int)((s64)cell_x * scenario->cell_y * scenario->percent / 100);
+        lay_snake(&game, length > 0 ? length : 1);
+    }
+
+    // Only the autopilot scenario steps, so only it draws interpolated.
+    SnakeTrail trail{};
+    TextMesh menu_text{};
+    text_set(&menu_text, "SNAKE 2D\nSTART\nEXIT", HMM_V2(400.0f, 600.0f), 50.0f);
+
+    // The first frames pay for shader and texture uploads, so leave them out.
+    int warmup = 10;
+    int frames = bench->quick ? 60 : 600;
+    std::vector<f64> times(frames);
+    for (int frame = -warmup; frame < frames; frame++) {
+        u64 start = now_ns();
+        if (scenario->kind == Scenario_Autopilot) {
+            if (game.status != Game_Playing) game_reset(&game, (u64)(frame + warmup));
+            SimInput input{};
+            input.turn = autopilot_choose(&autopilot, &game);
+            snake_trail_save(&trail, &game);
+            game_step(&game, input);
+        }
+        frame_begin(scenario->kind == Scenario_Menu);
+        sprite_begin(projection);
+        if (scenario->kind == Scenario_Menu) {
+            push_text_mesh(Layer_Text, &menu_text);
+            push_quad(Layer_Sprites, HMM_V2(400.0f - 50.0f, 550.0f), HMM_V2(50.0f, 50.0f), 0.0f, Sprite_Arrow);
+        } else {
+            draw_play(&game, &trail, 0.5f, window_dim, cell_size, (f32)frame);
+        }
+        sprite_flush();
+        glFinish();
+        if (frame >= 0) times[frame] = (f64)(now_ns() - start);
+    }
+
+    f64 total = 0.0;
+    for (int i = 0; i < frames; i++) total += times[i];
+    std::sort(times.begin(), times.end());
+    bench_report(bench, name, total / frames, frames);
+    bench_report(bench, p99_name, times[(frames * 99) / 100], frames);
+
+    text_free(&menu_text);
+    autopilot_free(&autopilot);
+    game_free(&game);
+}
+
+// Getting the atlas from disk into a texture, as render_init does: decoding
+// and packing the PNGs against mapping the baked pack. The files are warm in
+// the page cache after the first repeat, so this is the CPU side of a cold
+// start rather than the disk.
+static void bench_startup(Bench *bench) {
+    const char *names[] = {"startup/atlas_png", "startup/atlas_pack"};
+    f64 samples[BENCH_REPEATS];
+    for (int use_pack = 0; use_pack < 2; use_pack++) {
+        if (!bench_wanted(bench, names[use_pack])) continue;
+
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            u64 start = now_ns();
+            Atlas atlas;
+            b32 loaded = use_pack ? atlas_load_pack(&atlas, PACK_PATH) : atlas_build(&atlas);
+            if (!loaded) {
+                printf("No %s, skipping %s\n", use_pack ? PACK_PATH : "sprites", names[use_pack]);
+                atlas_free(&atlas);
+                return;
+            }
+            u32 texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas.width, atlas.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         atlas.pixels);
+            glFinish();
+            samples[r] = (f64)(now_ns() - start);
+            glDeleteTextures(1, &texture);
+            gl_state_invalidate();
+            atlas_free(&atlas);
+        }
+        bench_report(bench, names[use_pack], median(samples, BENCH_REPEATS), BENCH_REPEATS);
+    }
+
+    // The sprite shader compiled from source against loaded from a warm
+    // program binary cache. The driver may keep its own cache as well
+    // (Mesa does), which narrows the gap.
+    const char *cache_path = "build/bench_sprite.program";
+    const char *shader_names[] = {"startup/shader_compile", "startup/shader_cached"};
+    for (int cached = 0; cached < 2; cached++) {
+        if (!bench_wanted(bench, shader_names[cached])) continue;
+        if (cached && !program_binary_supported) {
+            printf("No program binaries, skipping %s\n", shader_names[cached]);
+            continue;
+        }
+
+        Shader shader{};
+        if (cached) shader_load(&shader, "data/shaders/sprite.vert", "data/shaders/sprite.frag", cache_path);
+        for (int r = 0; r < BENCH_REPEATS; r++) {
+            u64 start = now_ns();
+            shader_load(&shader, "data/shaders/sprite.vert", "data/shaders/sprite.frag", cached ? cache_path : NULL);
+            glFinish();
+            samples[r] = (f64)(now_ns() - start);
+        }
+        glDeleteProgram(shader.program);
+        gl_state_invalidate();
+        bench_report(bench, shader_names[cached], median(samples, BENCH_REPEATS), BENCH_REPEATS);
+    }
+}
+
+static void bench_render(Bench *bench) {
+    if (!bench_gl_init()) {
+        printf("No GL context, skipping the render benchmarks\n");
+        return;
+    }
+    if (!render_init()) return;
+
+    bench_startup(bench);
+    bench_sprites(bench);
+
+    Scenario scenarios[] = {
+        {"menu", Scenario_Menu, 20, 0},
+        {"play_35x20_fill=1%", Scenario_Fill, 20, 1},
+        {"play_35x20_fill=50%", Scenario_Fill, 20, 50},
+        {"play_35x20_fill=99%", Scenario_Fill, 20, 99},
+        {"play_142x80_fill=50%", Scenario_Fill, 80, 50},
+        {"autopilot_35x20", Scenario_Autopilot, 20, 0},
+    };
+    for (int i = 0; i < (int)(sizeof(scenarios) / sizeof(scenarios[0])); i++) {
+        bench_scenario(bench, &scenarios[i]);
+    }
+}
+
+#endif
+
+//
+// JSON
+//
+
+static b32 write_json(Bench *bench, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("Failed to open %s\n", path);
+        return false;
+    }
+    // One benchmark per line, which is also what read_baseline expects.
+    fprintf(file, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < bench->results.size(); i++) {
+        BenchResult *result = &bench->results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"iterations\": %llu}%s\n", result->name,
+                result->ns_per_op, (unsigned long long)result->iterations, i + 1 < bench->results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+static b32 read_baseline(const char *path, std::vector<BenchResult> *baseline) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Failed to open baseline %s\n", path);
+        return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *ns = strstr(line, "\"ns_per_op\": ");
+        if (name == NULL || ns == NULL) continue;
+        name += strlen("\"name\": \"");
+        const char *name_end = strchr(name, '"');
+        if (name_end == NULL) continue;
+
+        BenchResult result{};
+        int name_length = (int)std::min<size_t>(name_end - name, sizeof(result.name) - 1);
+        memcpy(result.name, name, name_length);
+        result.ns_per_op = atof(ns + strlen("\"ns_per_op\": "));
+        baseline->push_back(result);
+    }
+    fclose(file);
+    return true;
+}
+
+// Returns the number of benchmarks that got slower than the threshold allows.
+static int compare_baseline(Bench *bench, std::vector<BenchResult> *baseline, f64 threshold) {
+    int slower = 0;
+    printf("\n%-40s %12s %12s %8s\n", "benchmark", "baseline", "now", "change");
+    for (size_t i = 0; i < bench->results.size(); i++) {
+        BenchResult *result = &bench->results[i];
+        BenchResult *base = NULL;
+        for (size_t j = 0; j < baseline->size(); j++) {
+            if (strcmp((*baseline)[j].name, result->name) == 0) base = &(*baseline)[j];
+        }
+        if (base == NULL || base->ns_per_op <= 0.0) {
+            printf("%-40s %12s %12.2f %8s\n", result->name, "-", result->ns_per_op, "new");
+            continue;
+        }
+        f64 change = 100.0 * (result->ns_per_op - base->ns_per_op) / base->ns_per_op;
+        const char *verdict = "";
+        if (change > threshold) {
+            verdict = "  SLOWER";
+            slower++;
+        } else if (change < -threshold) {
+            verdict = "  faster";
+        }
+        printf("%-40s %12.2f %12.2f %+7.1f%%%s\n", result->name, base->ns_per_op, result->ns_per_op, change, verdict);
+    }
+    return slower;
+}
+
+int main(int argc, char **argv) {
+    Bench bench{};
+    bench.gl = true;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    f64 threshold = 5.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            bench.filter = argv[++i];
+        } else if (strcmp(argv[i], "--no-gl") == 0) {
+            bench.gl = false;
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            bench.quick = true;
+        } else {
+            printf("usage: snake_bench [--json PATH] [--baseline PATH] [--threshold PCT] [--filter TEXT] [--no-gl] [--quick]\n");
+            return 1;
+        }
+    }
+
+    bench_sim(&bench);
+#if !defined(BENCH_NO_GL)
+    if (bench.gl) bench_render(&bench);
+#endif
+
+    if (json_path && !write_json(&bench, json_path)) return 1;
+    if (baseline_path) {
+        std::vector<BenchResult> baseline;
+        if (!read_baseline(baseline_path, &baseline)) return 1;
+        int slower = compare_baseline(&bench, &baseline, threshold);
+        if (slower) {
+            printf("%d benchmark%s slower than the baseline by more than %.1f%%\n", slower, slower == 1 ? "" : "s", threshold);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef SNAKE_HANDOFF_H
+#define SNAKE_HANDOFF_H
+
+// A lock-free triple buffer over three slots the caller owns, for one
+// writer thread and one reader thread. The writer fills slot back and
+// publishes it; the reader takes the newest published slot as front. The
+// third slot sits between them. Neither side ever waits for the other, and
+// a reader that falls behind skips straight to the newest slot.
+
+#include <atomic>
+
+#include "snake_base.h"
+
+#define HANDOFF_SLOTS 3
+#define HANDOFF_FRESH 4u  // set on middle while it holds a slot the reader has not taken
+
+struct Handoff {
+    std::atomic<u32> middle;
+    u32 back;   // only touched by the writer
+    u32 front;  // only touched by the reader
+};
+
+inline void handoff_init(Handoff *handoff) {
+    handoff->back = 0;
+    handoff->middle.store(1);
+    handoff->front = 2;
+}
+
+// Hands the filled back slot to the reader and takes the middle one to
+// write next.
+inline void handoff_publish(Handoff *handoff) {
+    u32 old = handoff->middle.exchange(handoff->back | HANDOFF_FRESH, std::memory_order_acq_rel);
+    handoff->back = old & ~HANDOFF_FRESH;
+}
+
+inline b32 handoff_fresh(Handoff *handoff) {
+    return (handoff->middle.load(std::memory_order_acquire) & HANDOFF_FRESH) != 0;
+}
+
+// Moves front to the newest published slot. Returns false and keeps the
+// current front if nothing was published since the last call.
+inline b32 handoff_acquire(Handoff *handoff) {
+    if (!handoff_fresh(handoff)) return false;
+    u32 old = handoff->middle.exchange(handoff->front, std::memory_order_acq_rel);
+    handoff->front = old & ~HANDOFF_FRESH;
+    return true;
+}
+
+#endif // SNAKE_HANDOFF_H
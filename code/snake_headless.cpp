@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "snake_sim.h"
+#include "snake_batch.h"
+#include "snake_rollout.h"
+#include "snake_replay.h"
+
+// snake_headless batch [lanes] [steps] [width] [height]
+// Anything other than batch, clone or replay is handed to rollout_main.
+static int run_batch(int argc, char **argv) {
+    int lanes = argc > 2 ? atoi(argv[2]) : 4096;
+    int steps = argc > 3 ? atoi(argv[3]) : 10000;
+    int width = argc > 4 ? atoi(argv[4]) : 35;
+    int height = argc > 5 ? atoi(argv[5]) : 20;
+
+    GameBatch batch;
+    batch_init(&batch, lanes, width, height, 1);
+
+    // Random turns about one tick in eight, from a cheap per-step LCG.
+    s32 *turns = (s32 *)calloc(batch.lane_count, sizeof(s32));
+    u32 seed = 1;
+    clock_t start = clock();
+    for (int step = 0; step < steps; step++) {
+        for (int lane = 0; lane < lanes; lane++) {
+            seed = seed * 1664525u + 1013904223u;
+            turns[lane] = ((seed >> 24) & 7) < 4 ? (s32)((seed >> 24) & 3) + 1 : 0;
+        }
+        batch_step(&batch, turns);
+    }
+    f64 seconds = (f64)(clock() - start) / CLOCKS_PER_SEC;
+    u64 env_steps = (u64)lanes * steps;
+
+    printf("%d lanes (%d wide SIMD) x %d steps on %dx%d\n", lanes, BATCH_LANES, steps, width, height);
+    printf("%llu games finished, avg length %.2f, avg ticks %.1f\n", (unsigned long long)batch.games_finished,
+           batch.games_finished ? (f64)batch.total_length / batch.games_finished : 0.0,
+           batch.games_finished ? (f64)batch.total_ticks / batch.games_finished : 0.0);
+    printf("%.3f s, %.0f env-steps/s\n", seconds, env_steps / seconds);
+    arena_report("Batch", &batch.arena);
+
+    free(turns);
+    batch_free(&batch);
+    return 0;
+}
+
+// Times snapshot and restore with the greedy bot's snake at lengths up to
+// max_length, and checks that a restored game plays out exactly like the
+// original.
+static b32 clone_board(int width, int height, int max_length) {
+    const int iterations = 100000;
+
+    const Policy *greedy = find_policy("greedy");
+    GameState state;
+    game_init(&state, width, height, 1);
+    SnapshotPool pool = snapshot_pool_create(width, height, 64);
+    printf("board %dx%d, %llu byte slots\n", width, height, (unsigned long long)pool.slot_size);
+
+    int next_report = 1;
+    b32 ok = true;
+    while (state.status == Game_Playing && next_report <= max_length && ok) {
+        if (state.snake.length >= next_report) {
+            next_report *= 2;
+
+            clock_t start = clock();
+            u64 bytes = 0;
+            for (int i = 0; i < iterations; i++) {
+                bytes = game_snapshot(&state, snapshot_slot(&pool, i & 63));
+            }
+            f64 snapshot_ns = (f64)(clock() - start) / CLOCKS_PER_SEC * 1e9 / iterations;
+
+            start = clock();
+            for (int i = 0; i < iterations; i++) {
+                game_restore(&state, snapshot_slot(&pool, i & 63));
+            }
+            f64 restore_ns = (f64)(clock() - start) / CLOCKS_PER_SEC * 1e9 / iterations;
+            printf("length %5d: %6llu bytes, snapshot %7.1f ns, restore %7.1f ns\n", state.snake.length,
+                   (unsigned long long)bytes, snapshot_ns, restore_ns);
+
+            // Play ahead, rewind, and play the same moves again.
+            GameSnapshot *slot = snapshot_slot(&pool, 0);
+            game_snapshot(&state, slot);
+            Dir moves[256];
+            int played = 0;
+            for (; played < 256 && state.status == Game_Playing; played++) {
+                SimInput input{};
+                input.turn = moves[played] = greedy->choose(NULL, &state);
+                game_step(&state, input);
+            }
+            u64 ticks = state.ticks;
+            int length = state.snake.length;
+            Cell apple = state.apple;
+            game_restore(&state, slot);
+            for (int i = 0; i < played; i++) {
+                SimInput input{};
+                input.turn = moves[i];
+                game_step(&state, input);
+            }
+            ok = state.ticks == ticks && state.snake.length == length && state.apple.x == apple.x && state.apple.y == apple.y;
+            game_restore(&state, slot);
+        }
+        SimInput input{};
+        input.turn = greedy->choose(NULL, &state);
+        game_step(&state, input);
+    }
+    if (!ok) {
+        printf("restored game diverged from the original\n");
+    }
+
+    snapshot_pool_free(&pool);
+    game_free(&state);
+    return ok;
+}
+
+// snake_headless clone [width] [height]
+// Runs clone_board on the given board, then on a 1000x1000 one where
+// copying anything board-sized would show up.
+static int run_clone(int argc, char **argv) {
+    int width = argc > 2 ? atoi(argv[2]) : 35;
+    int height = argc > 3 ? atoi(argv[3]) : 20;
+
+    b32 ok = clone_board(width, height, width * height);
+    ok = clone_board(1000, 1000, 256) && ok;
+    return ok ? 0 : 1;
+}
+
+// snake_headless replay FILE
+// Re-simulates every record in FILE and checks each outcome against its header.
+static int run_replay(int argc, char **argv) {
+    if (argc < 3) {
+        printf("usage: snake_headless replay FILE\n");
+        return 1;
+    }
+
+    ReplayFile file;
+    if (!replay_open(&file, argv[2])) return 1;
+
+    GameState state{};
+    u32 width = 0, height = 0;
+    u64 records = 0, mismatches = 0, ticks = 0;
+    clock_t start = clock();
+    ReplayRecord record;
+    while (replay_next(&file, &record)) {
+        if (record.header.width != width || record.header.height != height) {
+            if (records) game_free(&state);
+            width = record.header.width;
+            height = record.header.height;
+            game_init(&state, width, height, record.header.seed);
+        }
+        if (!replay_play(&record, &state)) {
+            printf("record %llu: expected length %u after %llu ticks, got %d after %llu\n",
+                   (unsigned long long)records, record.header.length, (unsigned long long)record.header.ticks,
+                   state.snake.length, (unsigned long long)state.ticks);
+            mismatches++;
+        }
+        ticks += state.ticks;
+        records++;
+    }
+    f64 seconds = (f64)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%llu records, %llu bytes, %llu mismatches\n", (unsigned long long)records,
+           (unsigned long long)file.size, (unsigned long long)mismatches);
+    printf("%.3f s, %.0f ticks/s\n", seconds, ticks / seconds);
+    if (records) game_free(&state);
+    replay_close(&file);
+    return mismatches ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "batch") == 0) {
+        return run_batch(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "replay") == 0) {
+        return run_replay(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "clone") == 0) {
+        return run_clone(argc, argv);
+    }
+
+    return rollout_main(argc, argv);
+}
@@ -0,0 +1,312 @@
+#include "snake_mcts.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <chrono>
+
+#define MCTS_LEAF -1
+#define MCTS_EXPANDING -2
+#define MCTS_REWARD_ONE 65536
+
+static u64 now_ns() {
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MctsConfig mcts_default_config() {
+    MctsConfig config{};
+    config.threads = 1;
+    config.budget_ns = 10000000;
+    config.max_nodes = 1 << 18;
+    config.playout_ticks = 0;
+    config.exploration = 0.5f;
+    return config;
+}
+
+static void init_node(MctsNode *node, Dir dir) {
+    node->visits.store(0, std::memory_order_relaxed);
+    node->value.store(0, std::memory_order_relaxed);
+    node->children.store(MCTS_LEAF, std::memory_order_relaxed);
+    node->dir = (u8)dir;
+    node->child_count = 0;
+}
+
+static b32 move_is_safe(GameState *state, Dir dir) {
+    if (dir == dir_opposite(state->dir)) return false;
+    Cell next = snake_next_head(&state->snake, dir);
+    return !board_test(&state->board, next.x, next.y);
+}
+
+// Playouts lean towards the apple: three times in four they take a safe
+// step that closes the distance, otherwise any safe step.
+static Dir playout_move(GameState *state, Rng *rng) {
+    Dir safe[4];
+    int count = 0;
+    for (int dir = Left; dir <= Down; dir++) {
+        if (move_is_safe(state, (Dir)dir)) safe[count++] = (Dir)dir;
+    }
+    if (count == 0) return state->dir;
+
+    if (rng_below(rng, 4) != 0) {
+        Cell *head = snake_cell(&state->snake, 0);
+        for (int i = 0; i < count; i++) {
+            Dir dir = safe[i];
+            if ((dir == Left && state->apple.x < head->x) || (dir == Right && state->apple.x > head->x) ||
+                (dir == Up && state->apple.y > head->y) || (dir == Down && state->apple.y < head->y)) {
+                return dir;
+            }
+        }
+    }
+    return safe[rng_below(rng, count)];
+}
+
+// Half a point for being alive at the end of the playout and up to another
+// half for reaching an apple, less the sooner it was eaten. A win is worth
+// a full point.
+static u64 reward(GameState *state, int ate_at, int ticks) {
+    if (state->status == Game_Won) return MCTS_REWARD_ONE;
+    u64 value = state->status == Game_Dead ? 0 : MCTS_REWARD_ONE / 2;
+    if (ate_at >= 0) {
+        value += (MCTS_REWARD_ONE / 2) * (u64)(ticks + 1 - ate_at) / (u64)(ticks + 1);
+    }
+    return value;
+}
+
+static s32 select_child(Mcts *mcts, MctsNode *node) {
+    s32 first = node->children.load(std::memory_order_acquire);
+    f32 log_visits = logf((f32)node->visits.load(std::memory_order_relaxed) + 1.0f);
+
+    s32 best = first;
+    f32 best_score = -1.0f;
+    for (int i = 0; i < node->child_count; i++) {
+        MctsNode *child = &mcts->nodes[first + i];
+        u32 visits = child->visits.load(std::memory_order_relaxed);
+        if (visits == 0) return first + i;
+
+        // In-flight visits count as losses until their reward lands.
+        f32 mean = (f32)child->value.load(std::memory_order_relaxed) / ((f32)visits * MCTS_REWARD_ONE);
+        f32 score = mean + mcts->config.exploration * sqrtf(log_visits / (f32)visits);
+        if (score > best_score) {
+            best_score = score;
+            best = first + i;
+        }
+    }
+    return best;
+}
+
+// Adds a child for each move that survives the next tick from the
+// expanding thread's state, so the tree never spends visits on moves that
+// die straight away. Only the thread that wins the CAS expands a leaf;
+// others keep treating it as a leaf until the children are published.
+static b32 expand(Mcts *mcts, MctsNode *node, GameState *state) {
+    Dir moves[3];
+    int count = 0;
+    for (int dir = Left; dir <= Down; dir++) {
+        if (move_is_safe(state, (Dir)dir)) moves[count++] = (Dir)dir;
+    }
+    if (count == 0) return false;
+
+    s32 expected = MCTS_LEAF;
+    if (!node->children.compare_exchange_strong(expected, MCTS_EXPANDING, std::memory_order_acquire)) {
+        return false;
+    }
+
+    s32 first = mcts->node_count.fetch_add(count, std::memory_order_relaxed);
+    if (first + count > mcts->config.max_nodes) {
+        mcts->stop.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        init_node(&mcts->nodes[first + i], moves[i]);
+    }
+    node->child_count = (u8)count;
+    node->children.store(first, std::memory_order_release);
+    return true;
+}
+
+static void search(Mcts *mcts, MctsThread *thread) {
+    GameState *state = &thread->state;
+    int playout_ticks = mcts->config.playout_ticks ? mcts->config.playout_ticks : mcts->width + mcts->height;
+
+    while (!mcts->stop.load(std::memory_order_relaxed)) {
+        if (now_ns() >= mcts->deadline_ns) {
+            mcts->stop.store(true, std::memory_order_relaxed);
+            break;
+        }
+
+        game_restore(state, mcts->root);
+        rng_seed(&state->rng, rng_next(&thread->rng));
+
+        // Selection: walk down expanded nodes, counting each visit now.
+        int depth = 0;
+        int ate_at = -1;
+        s32 index = 0;
+        MctsNode *node = &mcts->nodes[0];
+        node->visits.fetch_add(1, std::memory_order_relaxed);
+        thread->path[depth++] = 0;
+        while (state->status == Game_Playing && depth <= MCTS_MAX_DEPTH) {
+            if (node->children.load(std::memory_order_acquire) < 0) {
+                if (node->visits.load(std::memory_order_relaxed) < 2 || !expand(mcts, node, state)) break;
+            }
+            index = select_child(mcts, node);
+            node = &mcts->nodes[index];
+            node->visits.fetch_add(1, std::memory_order_relaxed);
+            thread->path[depth++] = index;
+
+            SimInput input{};
+            input.turn = (Dir)node->dir;
+            game_step(state, input);
+            if (ate_at < 0 && state->snake.length > mcts->root_length) ate_at = depth - 1;
+        }
+        if (depth > thread->max_depth) thread->max_depth = depth;
+
+        // Playout from the leaf.
+        int ticks = depth - 1;
+        for (int tick = 0; tick < playout_ticks && state->status == Game_Playing; tick++) {
+            SimInput input{};
+            input.turn = playout_move(state, &thread->rng);
+            game_step(state, input);
+            ticks++;
+            if (ate_at < 0 && state->snake.length > mcts->root_length) ate_at = ticks;
+        }
+
+        u64 value = reward(state, ate_at, depth - 1 + playout_ticks);
+        for (int i = 0; i < depth; i++) {
+            mcts->nodes[thread->path[i]].value.fetch_add(value, std::memory_order_relaxed);
+        }
+        thread->playouts++;
+    }
+}
+
+static void helper_run(Mcts *mcts, int index) {
+    u64 seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(mcts->lock);
+            mcts->wake.wait(guard, [&] { return mcts->quit || mcts->search_id != seen; });
+            if (mcts->quit) return;
+            seen = mcts->search_id;
+        }
+
+        search(mcts, &mcts->threads[index]);
+
+        std::lock_guard<std::mutex> guard(mcts->lock);
+        if (--mcts->running == 0) mcts->done.notify_one();
+    }
+}
+
+void mcts_create(Mcts *mcts, int width, int height, MctsConfig *config) {
+    mcts->config = config ? *config : mcts_default_config();
+    if (mcts->config.threads < 1) mcts->config.threads = 1;
+    mcts->width = width;
+    mcts->height = height;
+
+    u64 nodes_size = (u64)mcts->config.max_nodes * sizeof(MctsNode);
+    u64 root_size = snapshot_max_size(width, height);
+    mcts->arena = arena_create(nodes_size + root_size + 1024);
+    mcts->nodes = (MctsNode *)arena_push(&mcts->arena, nodes_size);
+    mcts->root = (GameSnapshot *)arena_push(&mcts->arena, root_size);
+    mcts->node_count.store(0);
+    mcts->stop.store(false);
+    mcts->deadline_ns = 0;
+    mcts->root_length = 0;
+    mcts->playouts = 0;
+    mcts->nodes_used = 0;
+    mcts->max_depth = 0;
+
+    int threads = mcts->config.threads;
+    mcts->threads = new MctsThread[threads];
+    for (int i = 0; i < threads; i++) {
+        game_init(&mcts->threads[i].state, width, height, 0);
+    }
+    mcts_seed(mcts, 1);
+
+    mcts->search_id = 0;
+    mcts->running = 0;
+    mcts->quit = false;
+    mcts->handles = new std::thread[threads];
+    for (int i = 1; i < threads; i++) {
+        mcts->handles[i] = std::thread(helper_run, mcts, i);
+    }
+}
+
+void mcts_free(Mcts *mcts) {
+    {
+        std::lock_guard<std::mutex> guard(mcts->lock);
+        mcts->quit = true;
+    }
+    mcts->wake.notify_all();
+    for (int i = 1; i < mcts->config.threads; i++) {
+        mcts->handles[i].join();
+    }
+    for (int i = 0; i < mcts->config.threads; i++) {
+        game_free(&mcts->threads[i].state);
+    }
+    delete[] mcts->handles;
+    delete[] mcts->threads;
+    arena_release(&mcts->arena);
+    mcts->nodes = NULL;
+    mcts->root = NULL;
+    mcts->threads = NULL;
+    mcts->handles = NULL;
+}
+
+// Gives every search thread its own playout stream.
+void mcts_seed(Mcts *mcts, u64 seed) {
+    Rng rng;
+    rng_seed(&rng, seed);
+    for (int i = 0; i < mcts->config.threads; i++) {
+        mcts->threads[i].rng = rng_split(&rng);
+    }
+}
+
+Dir mcts_choose(Mcts *mcts, GameState *state) {
+    game_snapshot(state, mcts->root);
+    mcts->root_length = state->snake.length;
+    init_node(&mcts->nodes[0], state->dir);
+    mcts->node_count.store(1, std::memory_order_relaxed);
+    mcts->stop.store(false, std::memory_order_relaxed);
+    mcts->deadline_ns = now_ns() + mcts->config.budget_ns;
+    for (int i = 0; i < mcts->config.threads; i++) {
+        mcts->threads[i].playouts = 0;
+        mcts->threads[i].max_depth = 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(mcts->lock);
+        mcts->running = mcts->config.threads - 1;
+        mcts->search_id++;
+    }
+    mcts->wake.notify_all();
+    search(mcts, &mcts->threads[0]);
+    {
+        std::unique_lock<std::mutex> guard(mcts->lock);
+        mcts->done.wait(guard, [&] { return mcts->running == 0; });
+    }
+
+    mcts->playouts = 0;
+    mcts->max_depth = 0;
+    for (int i = 0; i < mcts->config.threads; i++) {
+        mcts->playouts += mcts->threads[i].playouts;
+        if (mcts->threads[i].max_depth > mcts->max_depth) mcts->max_depth = mcts->threads[i].max_depth;
+    }
+    s32 node_count = mcts->node_count.load(std::memory_order_relaxed);
+    mcts->nodes_used = node_count < mcts->config.max_nodes ? node_count : mcts->config.max_nodes;
+
+    // The most visited move is the most robust pick.
+    MctsNode *root = &mcts->nodes[0];
+    s32 first = root->children.load(std::memory_order_acquire);
+    if (first < 0) return playout_move(state, &mcts->threads[0].rng);
+    Dir best = state->dir;
+    u32 best_visits = 0;
+    for (int i = 0; i < root->child_count; i++) {
+        MctsNode *child = &mcts->nodes[first + i];
+        u32 visits = child->visits.load(std::memory_order_relaxed);
+        if (visits > best_visits) {
+            best_visits = visits;
+            best = (Dir)child->dir;
+        }
+    }
+    return best;
+}
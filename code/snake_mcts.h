@@ -0,0 +1,85 @@
+#ifndef SNAKE_MCTS_H
+#define SNAKE_MCTS_H
+
+// Monte Carlo tree search bot. Every search starts from a snapshot of the
+// game and replays moves into per-thread GameStates with game_step, so the
+// tree always follows the real rules. The tree is open loop: each playout
+// draws apples from its own stream rather than the game's, so the bot does
+// not see the apples it will actually get.
+//
+// Several threads grow one tree. Node statistics are atomics, a thread
+// counts a visit on the way down (virtual loss) so others spread out, and
+// a leaf is expanded by whichever thread wins a compare-and-swap on it.
+// Nodes come from a fixed array allocated by mcts_create; a search stops at
+// its deadline or when the array is full.
+
+#include "snake_sim.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define MCTS_MAX_DEPTH 256
+
+struct MctsConfig {
+    int threads;        // including the caller of mcts_choose
+    u64 budget_ns;      // per-move deadline
+    int max_nodes;
+    int playout_ticks;  // 0 for width + height
+    f32 exploration;
+};
+
+struct MctsNode {
+    std::atomic<u32> visits;
+    std::atomic<u64> value;     // summed reward, MCTS_REWARD_ONE per win
+    std::atomic<s32> children;  // first child, or MCTS_LEAF / MCTS_EXPANDING
+    u8 dir;
+    u8 child_count;
+};
+
+struct MctsThread {
+    GameState state;
+    Rng rng;
+    s32 path[MCTS_MAX_DEPTH + 1];
+    u64 playouts;
+    int max_depth;
+    u8 pad[64];
+};
+
+struct Mcts {
+    MctsConfig config;
+    int width;
+    int height;
+
+    MctsNode *nodes;
+    std::atomic<s32> node_count;
+    std::atomic<b32> stop;
+    u64 deadline_ns;
+    GameSnapshot *root;
+    int root_length;
+
+    MctsThread *threads;
+    std::thread *handles;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    u64 search_id;
+    int running;
+    b32 quit;
+
+    // Results of the last search
+    u64 playouts;
+    int nodes_used;
+    int max_depth;
+
+    MemoryArena arena;
+};
+
+MctsConfig mcts_default_config();
+void mcts_create(Mcts *mcts, int width, int height, MctsConfig *config);
+void mcts_free(Mcts *mcts);
+void mcts_seed(Mcts *mcts, u64 seed);
+Dir mcts_choose(Mcts *mcts, GameState *state);
+
+#endif // SNAKE_MCTS_H
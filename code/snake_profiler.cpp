@@ -0,0 +1,122 @@
+#include "snake_profiler.h"
+#include "snake_render.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+Profiler profiler;
+
+u64 profile_now_ns() {
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profiler_init() {
+    glGenQueries(PROFILE_GPU_QUERIES, profiler.queries);
+}
+
+// Collects every finished query; the newest one wins.
+static void poll_gpu_queries() {
+    for (int i = 0; i < PROFILE_GPU_QUERIES; i++) {
+        int index = (profiler.query_next + i) % PROFILE_GPU_QUERIES;
+        if (!profiler.query_pending[index]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(profiler.queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(profiler.queries[index], GL_QUERY_RESULT, &elapsed);
+        profiler.last_gpu_ns = elapsed;
+        profiler.query_pending[index] = false;
+    }
+}
+
+void profile_frame_begin() {
+    profiler.frame_start = profile_now_ns();
+    memset(profiler.zone_ns, 0, sizeof(profiler.zone_ns));
+    profiler.stats = {};
+
+    // A slot whose result has not come back yet is skipped rather than
+    // waited on, so a slow GPU only costs us samples.
+    profiler.query_active = false;
+    if (profiler.shown) {
+        int index = profiler.query_next;
+        if (!profiler.query_pending[index]) {
+            glBeginQuery(GL_TIME_ELAPSED, profiler.queries[index]);
+            profiler.query_active = true;
+        }
+    }
+}
+
+// Call after the last draw of the frame and before the swap.
+void profile_gpu_end() {
+    if (!profiler.query_active) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    profiler.query_pending[profiler.query_next] = true;
+    profiler.query_next = (profiler.query_next + 1) % PROFILE_GPU_QUERIES;
+    profiler.query_active = false;
+}
+
+void profile_frame_end() {
+    u64 frame_ns = profile_now_ns() - profiler.frame_start;
+    memcpy(profiler.last_zone_ns, profiler.zone_ns, sizeof(profiler.zone_ns));
+    profiler.last_stats = profiler.stats;
+    profiler.last_frame_ns = frame_ns;
+
+    profiler.history_ms[profiler.history_next] = (f32)(frame_ns / 1000000.0);
+    profiler.history_next = (profiler.history_next + 1) % PROFILE_HISTORY;
+    if (profiler.history_count < PROFILE_HISTORY) profiler.history_count++;
+
+    if (profiler.shown) poll_gpu_queries();
+}
+
+static f32 percentile(f32 *sorted, int count, int percent) {
+    int index = (count - 1) * percent / 100;
+    return sorted[index];
+}
+
+// The font only has ' ' to 'Z', so every label is upper case.
+void draw_profiler(f32 window_height) {
+    if (!profiler.shown) return;
+
+    const f32 char_size = 16.0f;
+    HMM_Vec2 pos = HMM_V2(8.0f, window_height - 8.0f - char_size);
+    char line[128];
+
+    u64 *zone = profiler.last_zone_ns;
+    u64 cpu_ns = 0;
+    for (int i = 0; i < Zone_Count; i++) cpu_ns += zone[i];
+
+    snprintf(line, sizeof(line), "FRAME %.2f MS  CPU %.2f MS  GPU %.2f MS", profiler.last_frame_ns / 1e6,
+             cpu_ns / 1e6, profiler.last_gpu_ns / 1e6);
+    push_text(Layer_Overlay, line, pos, char_size);
+    pos.Y -= char_size;
+
+    snprintf(line, sizeof(line), "EVENTS %.2f  SIM %.2f  GRID %.2f", zone[Zone_Events] / 1e6, zone[Zone_Sim] / 1e6,
+             zone[Zone_Grid] / 1e6);
+    push_text(Layer_Overlay, line, pos, char_size);
+    pos.Y -= char_size;
+
+    snprintf(line, sizeof(line), "CELLS %.2f  TEXT %.2f  FLUSH %.2f  SWAP %.2f", zone[Zone_Cells] / 1e6,
+             zone[Zone_Text] / 1e6, zone[Zone_Flush] / 1e6, zone[Zone_Swap] / 1e6);
+    push_text(Layer_Overlay, line, pos, char_size);
+    pos.Y -= char_size;
+
+    RenderStats *stats = &profiler.last_stats;
+    snprintf(line, sizeof(line), "DRAWS %u  BINDS %u  STATE %u  SKIPPED %u  UPLOAD %.1f KB", stats->draw_calls,
+             stats->texture_binds, stats->state_changes, stats->state_skips, stats->bytes_uploaded / 1024.0);
+    push_text(Layer_Overlay, line, pos, char_size);
+    pos.Y -= char_size;
+
+    f32 sorted[PROFILE_HISTORY];
+    int count = profiler.history_count;
+    if (count > 0) {
+        memcpy(sorted, profiler.history_ms, count * sizeof(f32));
+        std::sort(sorted, sorted + count);
+        snprintf(line, sizeof(line), "P50 %.1f  P95 %.1f  P99 %.1f  MAX %.1f MS (%d)", percentile(sorted, count, 50),
+                 percentile(sorted, count, 95), percentile(sorted, count, 99), sorted[count - 1], count);
+        push_text(Layer_Overlay, line, pos, char_size);
+    }
+}
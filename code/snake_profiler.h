@@ -0,0 +1,77 @@
+#ifndef SNAKE_PROFILER_H
+#define SNAKE_PROFILER_H
+
+// Per-frame CPU zone timers, GPU time from GL_TIME_ELAPSED queries and GL
+// call counters, shown as a text overlay. Zone timers and counters always
+// run; GPU queries are only issued while the overlay is shown. GPU results
+// are read back a few frames late so the query never stalls the pipeline.
+
+#include "snake_base.h"
+
+#define PROFILE_HISTORY 240
+#define PROFILE_GPU_QUERIES 4
+
+enum ProfileZone {
+    Zone_Events,
+    Zone_Sim,
+    Zone_Grid,
+    Zone_Cells,
+    Zone_Text,
+    Zone_Flush,
+    Zone_Swap,
+    Zone_Count,
+};
+
+struct RenderStats {
+    u32 draw_calls;
+    u32 texture_binds;
+    u32 state_changes;
+    u32 state_skips;  // redundant binds and uniforms the state cache dropped
+    u64 bytes_uploaded;
+};
+
+struct Profiler {
+    b32 shown;
+
+    u64 frame_start;
+    u64 zone_start[Zone_Count];
+    u64 zone_ns[Zone_Count];
+    RenderStats stats;
+
+    // The last finished frame, which is what the overlay shows.
+    u64 last_zone_ns[Zone_Count];
+    RenderStats last_stats;
+    u64 last_frame_ns;
+    u64 last_gpu_ns;
+
+    f32 history_ms[PROFILE_HISTORY];
+    int history_count;
+    int history_next;
+
+    u32 queries[PROFILE_GPU_QUERIES];
+    b32 query_pending[PROFILE_GPU_QUERIES];
+    int query_next;
+    b32 query_active;
+};
+
+extern Profiler profiler;
+
+u64 profile_now_ns();
+
+inline void profile_begin(ProfileZone zone) {
+    profiler.zone_start[zone] = profile_now_ns();
+}
+
+inline void profile_end(ProfileZone zone) {
+    profiler.zone_ns[zone] += profile_now_ns() - profiler.zone_start[zone];
+}
+
+void profiler_init();
+void profile_frame_begin();
+void profile_gpu_end();
+void profile_frame_end();
+
+// Queues the overlay in the top left corner if it is shown.
+void draw_profiler(f32 window_height);
+
+#endif // SNAKE_PROFILER_H
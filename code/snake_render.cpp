@@ -0,0 +1,735 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snake_render.h"
+#include "snake_profiler.h"
+
+#include <algorithm>
+
+u32 quad_vbo;
+Shader sprite_shader;
+u32 sprite_vao;
+u32 sprite_vbo;
+u32 sprite_atlas;
+
+#define GL_STATE_UNKNOWN 0xFFFFFFFF
+
+// What this process last bound. GL_STATE_UNKNOWN forces the next call
+// through.
+struct GLState {
+    u32 program;
+    u32 vertex_array;
+    u32 texture;
+    u32 array_buffer;
+    u32 blend;
+};
+
+static GLState gl_state = {GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN};
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP GLGetProgramBinaryProc)(GLuint program, GLsizei size, GLsizei *length, GLenum *format,
+                                                void *binary);
+typedef void (APIENTRYP GLProgramBinaryProc)(GLuint program, GLenum format, const void *binary, GLsizei length);
+typedef void (APIENTRYP GLProgramParameteriProc)(GLuint program, GLenum name, GLint value);
+
+b32 program_binary_supported;
+static GLGetProgramBinaryProc gl_get_program_binary;
+static GLProgramBinaryProc gl_program_binary;
+static GLProgramParameteriProc gl_program_parameteri;
+
+#define SPRITE_VERTEX_PATH "data/shaders/sprite.vert"
+#define SPRITE_FRAGMENT_PATH "data/shaders/sprite.frag"
+#define SPRITE_PROGRAM_CACHE_PATH "data/sprite.program"
+
+static const char *uniform_names[Uniform_Count] = {
+    "projection",
+    "sprite_rect",
+    "sprite_repeat",
+};
+
+// Sprites queued since sprite_begin, and one sort key per sprite: layer in
+// the high 32 bits and the sprite's index in the low 32, which keeps
+// submission order within a layer.
+struct SpriteBatch {
+    HMM_Mat4 projection;
+    SpriteInstance *sprites;
+    u64 *keys;
+    int count;
+    int capacity;
+
+    // sprite_vbo is used as a ring. Each flush writes past the last one and
+    // the buffer is only orphaned when it wraps, so a write never touches
+    // storage a pending draw may still read.
+    int ring_capacity;
+    int ring_head;
+};
+
+static SpriteBatch batch;
+
+// The grid as last drawn, kept in a framebuffer of the window's size.
+struct Background {
+    u32 framebuffer;
+    u32 color;
+    int width;
+    int height;
+    f32 cell_size;
+};
+
+static Background background;
+
+// The score as last laid out, redone only when the length changes.
+static TextMesh score_text;
+static int score_length = -1;
+
+// The atlas table, kept to hand to a reloaded sprite shader.
+static f32 atlas_rects[Sprite_Count * 4];
+static u32 atlas_repeat_mask;
+
+static_assert(Sprite_Count == 10, "SPRITE_COUNT_STRING is out of date");
+
+void gl_state_invalidate() {
+    gl_state.program = GL_STATE_UNKNOWN;
+    gl_state.vertex_array = GL_STATE_UNKNOWN;
+    gl_state.texture = GL_STATE_UNKNOWN;
+    gl_state.array_buffer = GL_STATE_UNKNOWN;
+    gl_state.blend = GL_STATE_UNKNOWN;
+}
+
+static b32 gl_state_set(u32 *current, u32 value) {
+    if (*current == value) {
+        profiler.stats.state_skips++;
+        return false;
+    }
+    *current = value;
+    profiler.stats.state_changes++;
+    return true;
+}
+
+void gl_use_program(u32 program) {
+    if (gl_state_set(&gl_state.program, program)) glUseProgram(program);
+}
+
+void gl_bind_vertex_array(u32 vertex_array) {
+    if (gl_state_set(&gl_state.vertex_array, vertex_array)) glBindVertexArray(vertex_array);
+}
+
+void gl_bind_texture(u32 texture) {
+    if (gl_state_set(&gl_state.texture, texture)) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        profiler.stats.texture_binds++;
+    }
+}
+
+void gl_bind_array_buffer(u32 buffer) {
+    if (gl_state_set(&gl_state.array_buffer, buffer)) glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+// Blending is always SRC_ALPHA, ONE_MINUS_SRC_ALPHA; only whether it is on
+// changes.
+void gl_set_blend(b32 enabled) {
+    if (!gl_state_set(&gl_state.blend, enabled ? 1 : 0)) return;
+    if (enabled) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        glDisable(GL_BLEND);
+    }
+}
+
+// Prepended to every shader file: GLSL wants #version first, and the
+// sprite table size comes from SpriteId.
+static const char *shader_header = "#version 330 core\n#define SPRITE_COUNT " SPRITE_COUNT_STRING "\n#line 1\n";
+
+static u32 gl_shader_compile(GLenum type, const char *src, const char *name) {
+    u32 shader = glCreateShader(type);
+    const char *sources[] = {shader_header, src};
+    glShaderSource(shader, 2, sources, nullptr);
+    glCompileShader(shader);
+
+    int status = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        char log[1024] = {};
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        printf("Failed to compile %s:\n%s\n", name, log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static b32 gl_program_linked(u32 program, const char *name) {
+    int status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status && name) {
+        char log[1024] = {};
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        printf("Failed to link %s:\n%s\n", name, log);
+    }
+    return status;
+}
+
+// Returns 0 if either stage fails to compile or the program fails to link.
+u32 gl_shader_create(const char *vertex_src, const char *frag_src) {
+    u32 vshader = gl_shader_compile(GL_VERTEX_SHADER, vertex_src, "vertex shader");
+    u32 fshader = gl_shader_compile(GL_FRAGMENT_SHADER, frag_src, "fragment shader");
+    if (!vshader || !fshader) {
+        glDeleteShader(vshader);
+        glDeleteShader(fshader);
+        return 0;
+    }
+
+    u32 program = glCreateProgram();
+    if (program_binary_supported) {
+        gl_program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, vshader);
+    glAttachShader(program, fshader);
+    glLinkProgram(program);
+    glDeleteShader(vshader);
+    glDeleteShader(fshader);
+    if (!gl_program_linked(program, "shader program")) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static char *read_text_file(const char *path) {
+    u64 size;
+    const void *data = platform_map_file(path, &size);
+    if (data == NULL) {
+        printf("Failed to read shader: %s\n", path);
+        return NULL;
+    }
+    char *text = (char *)malloc(size + 1);
+    memcpy(text, data, size);
+    text[size] = '\0';
+    platform_unmap_file(data, size);
+    return text;
+}
+
+u32 gl_shader_create_file(const char *vertex_name, const char *frag_name) {
+    char *vertex_src = read_text_file(vertex_name);
+    char *frag_src = read_text_file(frag_name);
+    u32 result = 0;
+    if (vertex_src && frag_src) {
+        result = gl_shader_create(vertex_src, frag_src);
+    }
+    free(vertex_src);
+    free(frag_src);
+    return result;
+}
+
+//
+// Program binary cache
+//
+
+// glad here only covers core 3.3, so the GL_ARB_get_program_binary entry
+// points are fetched by hand. Without them every start compiles.
+void gl_load_extensions(GLADloadproc load) {
+    program_binary_supported = false;
+    int extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (int i = 0; i < extension_count; i++) {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (name && strcmp(name, "GL_ARB_get_program_binary") == 0) {
+            program_binary_supported = true;
+        }
+    }
+    int format_count = 0;
+    if (program_binary_supported) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    }
+    gl_get_program_binary = (GLGetProgramBinaryProc)load("glGetProgramBinary");
+    gl_program_binary = (GLProgramBinaryProc)load("glProgramBinary");
+    gl_program_parameteri = (GLProgramParameteriProc)load("glProgramParameteri");
+    program_binary_supported = program_binary_supported && format_count > 0 && gl_get_program_binary &&
+                               gl_program_binary && gl_program_parameteri;
+}
+
+static u64 hash_string(u64 hash, const char *text) {
+    for (const char *c = text; c && *c; c++) {
+        hash = (hash ^ (u8)*c) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// The cache key covers the sources as compiled and the driver, since a
+// binary is only good for the driver build that produced it.
+static u64 program_cache_key(const char *vertex_src, const char *frag_src) {
+    u64 hash = 0xCBF29CE484222325ull;
+    hash = hash_string(hash, shader_header);
+    hash = hash_string(hash, vertex_src);
+    hash = hash_string(hash, frag_src);
+    hash = hash_string(hash, (const char *)glGetString(GL_VENDOR));
+    hash = hash_string(hash, (const char *)glGetString(GL_RENDERER));
+    hash = hash_string(hash, (const char *)glGetString(GL_VERSION));
+    return hash;
+}
+
+static u32 program_cache_load(const char *path, u64 key) {
+    u64 size;
+    const u8 *data = (const u8 *)platform_map_file(path, &size);
+    if (data == NULL) return 0;
+
+    ProgramCacheHeader header;
+    u32 program = 0;
+    if (size >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+        if (header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION && header.key == key &&
+            sizeof(header) + (u64)header.size <= size) {
+            program = glCreateProgram();
+            gl_program_binary(program, header.format, data + sizeof(header), header.size);
+            // A driver may still turn a binary down, e.g. after an update
+            // that kept its version string.
+            if (!gl_program_linked(program, NULL)) {
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+    }
+    platform_unmap_file(data, size);
+    return program;
+}
+
+static void program_cache_store(const char *path, u64 key, u32 program) {
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    ProgramCacheHeader header{};
+    header.magic = PROGRAM_CACHE_MAGIC;
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    u8 *binary = (u8 *)malloc(length);
+    GLenum format = 0;
+    gl_get_program_binary(program, length, NULL, &format, binary);
+    header.format = format;
+    header.size = (u32)length;
+
+    FILE *file = fopen(path, "wb");
+    if (file) {
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary, length, 1, file);
+        fclose(file);
+    }
+    free(binary);
+}
+
+// Builds the program from its files, through the binary cache when there
+// is one. On failure the shader keeps its current program, so a bad edit
+// during hot reload leaves the last good one running.
+b32 shader_load(Shader *shader, const char *vertex_path, const char *frag_path, const char *cache_path) {
+    char *vertex_src = read_text_file(vertex_path);
+    char *frag_src = read_text_file(frag_path);
+    u32 program = 0;
+    if (vertex_src && frag_src) {
+        b32 use_cache = cache_path && program_binary_supported;
+        u64 key = use_cache ? program_cache_key(vertex_src, frag_src) : 0;
+        if (use_cache) program = program_cache_load(cache_path, key);
+        if (!program) {
+            program = gl_shader_create(vertex_src, frag_src);
+            if (program && use_cache) program_cache_store(cache_path, key, program);
+        }
+    }
+    free(vertex_src);
+    free(frag_src);
+    if (!program) return false;
+
+    if (shader->program) {
+        glDeleteProgram(shader->program);
+        gl_state_invalidate();
+    }
+    shader->program = program;
+    for (int i = 0; i < Uniform_Count; i++) {
+        shader->locations[i] = glGetUniformLocation(program, uniform_names[i]);
+    }
+    shader->projection_set = false;
+    return true;
+}
+
+void shader_set_projection(Shader *shader, HMM_Mat4 projection) {
+    if (shader->projection_set && memcmp(&shader->projection, &projection, sizeof(projection)) == 0) {
+        profiler.stats.state_skips++;
+        return;
+    }
+    gl_use_program(shader->program);
+    glUniformMatrix4fv(shader->locations[Uniform_Projection], 1, false, (f32 *)&projection);
+    shader->projection = projection;
+    shader->projection_set = true;
+    profiler.stats.state_changes++;
+}
+
+void sprite_begin(HMM_Mat4 projection) {
+    batch.projection = projection;
+    batch.count = 0;
+}
+
+// Reserves count sprites in a row on one layer.
+static SpriteInstance *push_sprites(SpriteLayer layer, int count) {
+    if (batch.count + count > batch.capacity) {
+        if (batch.capacity == 0) batch.capacity = 1024;
+        while (batch.count + count > batch.capacity) {
+            batch.capacity *= 2;
+        }
+        batch.sprites = (SpriteInstance *)realloc(batch.sprites, batch.capacity * sizeof(SpriteInstance));
+        batch.keys = (u64 *)realloc(batch.keys, batch.capacity * sizeof(u64));
+    }
+    int first = batch.count;
+    for (int i = first; i < first + count; i++) {
+        batch.keys[i] = ((u64)layer << 32) | (u64)i;
+    }
+    batch.count += count;
+    return &batch.sprites[first];
+}
+
+static SpriteInstance *push_sprite(SpriteLayer layer) {
+    return push_sprites(layer, 1);
+}
+
+void push_quad(SpriteLayer layer, HMM_Vec2 translation, HMM_Vec2 scale, f32 rotation, SpriteId id) {
+    SpriteInstance *sprite = push_sprite(layer);
+    *sprite = {translation.X, translation.Y, scale.X, scale.Y, 0.0f, 0.0f, 1.0f, 1.0f, rotation, (u32)id};
+}
+
+// One quad over the window; the grid sprite repeats once per two cells.
+static SpriteInstance grid_sprite(HMM_Vec2 window_dim, f32 cell_size) {
+    f32 cell_x = (window_dim.Width / cell_size) / 2.0f;
+    f32 cell_y = (window_dim.Height / cell_size) / 2.0f;
+    return {0.0f, 0.0f, window_dim.Width, window_dim.Height, 0.0f, 0.0f, cell_x, cell_y, 0.0f, Sprite_Grid};
+}
+
+void push_grid(SpriteLayer layer, HMM_Vec2 window_dim, f32 cell_size) {
+    *push_sprite(layer) = grid_sprite(window_dim, cell_size);
+}
+
+// Writes a glyph quad per character into dest, which has room for one per
+// byte of text. Returns how many were written; newlines take none.
+static int layout_text(SpriteInstance *dest, const char *text, HMM_Vec2 start, f32 char_size) {
+    HMM_Vec2 pos = start;
+    f32 glyph_step = 8.0f / 472.0f;
+    int count = 0;
+
+    for (const char *ptr = text; *ptr; ptr++) {
+        char ch = *ptr;
+        if (ch == '\n') {
+            pos.x = start.x;
+            pos.y -= char_size;
+            continue;
+        }
+
+        f32 off_x = (f32)(ch - ' ') * glyph_step;
+        dest[count++] = {pos.x, pos.y, char_size, char_size, off_x, 0.0f, off_x + glyph_step, 1.0f, 0.0f, Sprite_Font};
+        pos.x += char_size;
+    }
+    return count;
+}
+
+void push_text(SpriteLayer layer, const char *text, HMM_Vec2 start, f32 char_size) {
+    int length = (int)strlen(text);
+    SpriteInstance *dest = push_sprites(layer, length);
+    // Give back the slots newlines did not use.
+    batch.count -= length - layout_text(dest, text, start, char_size);
+}
+
+void text_set(TextMesh *mesh, const char *text, HMM_Vec2 start, f32 char_size) {
+    int length = (int)strlen(text);
+    if (mesh->text && strcmp(mesh->text, text) == 0 && mesh->start.X == start.X && mesh->start.Y == start.Y &&
+        mesh->char_size == char_size) {
+        return;
+    }
+
+    if (length + 1 > mesh->capacity) {
+        mesh->capacity = length + 1;
+        mesh->text = (char *)realloc(mesh->text, mesh->capacity);
+        mesh->sprites = (SpriteInstance *)realloc(mesh->sprites, mesh->capacity * sizeof(SpriteInstance));
+    }
+    memcpy(mesh->text, text, length + 1);
+    mesh->start = start;
+    mesh->char_size = char_size;
+    mesh->count = layout_text(mesh->sprites, text, start, char_size);
+}
+
+void push_text_mesh(SpriteLayer layer, TextMesh *mesh) {
+    memcpy(push_sprites(layer, mesh->count), mesh->sprites, mesh->count * sizeof(SpriteInstance));
+}
+
+void text_free(TextMesh *mesh) {
+    free(mesh->text);
+    free(mesh->sprites);
+    *mesh = {};
+}
+
+void snake_trail_save(SnakeTrail *trail, GameState *game) {
+    trail->tail = *snake_cell(&game->snake, game->snake.length - 1);
+    trail->length = game->snake.length;
+    trail->ticks = game->ticks;
+}
+
+// Each segment moved onto the cell of the one ahead of it, so where it was
+// a tick ago is where the next segment is now. Only the last one needs the
+// trail: it came from the saved tail, or stayed put if the snake grew.
+void push_snake(SpriteLayer layer, Snake *snake, SnakeTrail *trail, f32 blend, f32 cell_size) {
+    SpriteInstance *dest = push_sprites(layer, snake->length);
+    for (int i = 0; i < snake->length; i++) {
+        Cell *cell = snake_cell(snake, i);
+        f32 x = (f32)cell->x;
+        f32 y = (f32)cell->y;
+        if (trail) {
+            Cell *from = cell;
+            if (i + 1 < snake->length) {
+                from = snake_cell(snake, i + 1);
+            } else if (snake->length == trail->length) {
+                from = &trail->tail;
+            }
+            x = (f32)from->x + (x - (f32)from->x) * blend;
+            y = (f32)from->y + (y - (f32)from->y) * blend;
+        }
+        dest[i] = {x * cell_size, y * cell_size, cell_size, cell_size, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, Sprite_Cell};
+    }
+}
+
+static void sprite_attributes(int first) {
+    GLsizei stride = sizeof(SpriteInstance);
+    u8 *base = (u8 *)0 + (u64)first * sizeof(SpriteInstance);
+    glVertexAttribPointer(2, 4, GL_FLOAT, false, stride, base);
+    glVertexAttribPointer(3, 4, GL_FLOAT, false, stride, base + 4 * sizeof(f32));
+    glVertexAttribPointer(4, 1, GL_FLOAT, false, stride, base + 8 * sizeof(f32));
+    glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, stride, base + 9 * sizeof(f32));
+}
+
+// Maps room for count instances at the ring head, orphaning the ring when
+// they do not fit. Returns NULL if the driver refuses the mapping, and the
+// caller then skips its draw.
+static SpriteInstance *ring_map(int count) {
+    gl_bind_array_buffer(sprite_vbo);
+    if (count > batch.ring_capacity) {
+        while (batch.ring_capacity < count) {
+            batch.ring_capacity *= 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, batch.ring_capacity * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
+        batch.ring_head = 0;
+    } else if (batch.ring_head + count > batch.ring_capacity) {
+        glBufferData(GL_ARRAY_BUFFER, batch.ring_capacity * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
+        batch.ring_head = 0;
+    }
+
+    SpriteInstance *result = (SpriteInstance *)glMapBufferRange(
+        GL_ARRAY_BUFFER, batch.ring_head * sizeof(SpriteInstance), count * sizeof(SpriteInstance),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (result == NULL) {
+        printf("Failed to map %d sprite instances: GL error 0x%x\n", count, glGetError());
+    }
+    return result;
+}
+
+// Unmaps the instances written since ring_map and draws them. GL 3.3 has
+// no base instance, so the instance attributes are pointed at this slice of
+// the ring instead.
+static void ring_draw(int count, HMM_Mat4 projection) {
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    profiler.stats.bytes_uploaded += count * sizeof(SpriteInstance);
+
+    gl_bind_vertex_array(sprite_vao);
+    gl_use_program(sprite_shader.program);
+    shader_set_projection(&sprite_shader, projection);
+    sprite_attributes(batch.ring_head);
+    gl_bind_texture(sprite_atlas);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+    profiler.stats.draw_calls++;
+
+    batch.ring_head += count;
+}
+
+// Uploads the queue in sorted order and draws it. Everything samples the
+// one atlas, so the whole queue is a single instanced draw.
+void sprite_flush() {
+    int count = batch.count;
+    if (count == 0) return;
+    std::sort(batch.keys, batch.keys + count);
+
+    SpriteInstance *dest = ring_map(count);
+    if (dest) {
+        for (int i = 0; i < count; i++) {
+            dest[i] = batch.sprites[(u32)batch.keys[i]];
+        }
+        ring_draw(count, batch.projection);
+    }
+    batch.count = 0;
+}
+
+// Draws the grid into the background framebuffer at the window's size.
+// Called outside the frame's queue, so it draws its one quad directly.
+static void background_build(int width, int height, f32 cell_size) {
+    GLint target, viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (background.framebuffer == 0) {
+        glGenFramebuffers(1, &background.framebuffer);
+        glGenRenderbuffers(1, &background.color);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, background.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, background.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, background.color);
+    glViewport(0, 0, width, height);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    gl_set_blend(true);
+    HMM_Vec2 dim = HMM_V2((f32)width, (f32)height);
+    SpriteInstance *dest = ring_map(1);
+    if (dest) {
+        *dest = grid_sprite(dim, cell_size);
+        ring_draw(1, HMM_Orthographic_RH_NO(0.0f, dim.Width, 0.0f, dim.Height, -1.0f, 1.0f));
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    // Without the grid drawn, leave the size unset so the next frame retries.
+    background.width = dest ? width : 0;
+    background.height = height;
+    background.cell_size = cell_size;
+}
+
+// Rebuilds the background only when the window or cell size changed, so a
+// steady frame pays for a copy rather than shading the whole window.
+void background_draw(HMM_Vec2 window_dim, f32 cell_size) {
+    int width = (int)window_dim.Width;
+    int height = (int)window_dim.Height;
+    if (width <= 0 || height <= 0) return;
+    if (background.framebuffer == 0 || background.width != width || background.height != height ||
+        background.cell_size != cell_size) {
+        background_build(width, height, cell_size);
+    }
+
+    GLint target;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &target);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, background.framebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+}
+
+// Prefers the baked pack; without one, builds the atlas from the PNGs.
+static void load_atlas() {
+    Atlas atlas;
+    if (!atlas_load_pack(&atlas, PACK_PATH)) {
+        atlas_build(&atlas);
+    }
+
+    glGenTextures(1, &sprite_atlas);
+    gl_bind_texture(sprite_atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas.width, atlas.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas.pixels);
+    profiler.stats.bytes_uploaded += (u64)atlas.width * atlas.height * 4;
+
+    // The UV table: each sprite's rect in atlas texels.
+    for (int i = 0; i < Sprite_Count; i++) {
+        atlas_rects[i * 4 + 0] = atlas.rects[i].x;
+        atlas_rects[i * 4 + 1] = atlas.rects[i].y;
+        atlas_rects[i * 4 + 2] = atlas.rects[i].w;
+        atlas_rects[i * 4 + 3] = atlas.rects[i].h;
+    }
+    atlas_repeat_mask = atlas.repeat_mask;
+    atlas_free(&atlas);
+}
+
+static void sprite_shader_uniforms() {
+    gl_use_program(sprite_shader.program);
+    glUniform4fv(sprite_shader.locations[Uniform_SpriteRect], Sprite_Count, atlas_rects);
+    glUniform1ui(sprite_shader.locations[Uniform_SpriteRepeat], atlas_repeat_mask);
+}
+
+// Rebuilds the sprite shader from its files. Returns false and keeps the
+// running program if the new one does not compile.
+b32 render_reload_shaders() {
+    if (!shader_load(&sprite_shader, SPRITE_VERTEX_PATH, SPRITE_FRAGMENT_PATH, SPRITE_PROGRAM_CACHE_PATH)) {
+        return false;
+    }
+    sprite_shader_uniforms();
+    background.width = 0;  // redrawn with the new shader
+    return true;
+}
+
+// Loads the sprite shader and the atlas and sets up the unit quad and the
+// instance ring. Returns false if the shader could not be built, since
+// nothing can be drawn without it.
+b32 render_init() {
+    gl_state_invalidate();
+    if (!shader_load(&sprite_shader, SPRITE_VERTEX_PATH, SPRITE_FRAGMENT_PATH, SPRITE_PROGRAM_CACHE_PATH)) {
+        printf("Failed to load the sprite shader from %s and %s\n", SPRITE_VERTEX_PATH, SPRITE_FRAGMENT_PATH);
+        return false;
+    }
+
+    f32 quad_verts[] = {
+        0.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+
+        0.0f, 0.0f, 0.0f, 0.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+        1.0f, 0.0f, 1.0f, 0.0f,
+    };
+
+    glGenBuffers(1, &quad_vbo);
+    gl_bind_array_buffer(quad_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad_verts), quad_verts, GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &sprite_vao);
+    gl_bind_vertex_array(sprite_vao);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, false, 4 * sizeof(f32), (void *)(2 * sizeof(f32)));
+
+    batch.ring_capacity = 16384;
+    batch.ring_head = 0;
+    glGenBuffers(1, &sprite_vbo);
+    gl_bind_array_buffer(sprite_vbo);
+    glBufferData(GL_ARRAY_BUFFER, batch.ring_capacity * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
+    for (int i = 2; i <= 5; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    sprite_attributes(0);
+
+    load_atlas();
+    sprite_shader_uniforms();
+    return true;
+}
+
+void draw_play(GameState *game, SnakeTrail *trail, f32 blend, HMM_Vec2 window_dim, f32 cell_size,
+               f32 apple_rotation) {
+    profile_begin(Zone_Grid);
+    background_draw(window_dim, cell_size);
+    profile_end(Zone_Grid);
+
+    profile_begin(Zone_Cells);
+    HMM_Vec2 cell_dim = HMM_V2(cell_size, cell_size);
+    push_quad(Layer_Sprites, HMM_V2(game->apple.x * cell_size, game->apple.y * cell_size), cell_dim, apple_rotation,
+              Sprite_Apple);
+    // A trail from any other tick than the one before would slide the
+    // snake from somewhere it never was.
+    if (trail && trail->ticks + 1 != game->ticks) trail = NULL;
+    push_snake(Layer_Sprites, &game->snake, trail, blend, cell_size);
+    profile_end(Zone_Cells);
+
+    profile_begin(Zone_Text);
+    if (game->snake.length != score_length) {
+        char buffer[12]{};
+        sprintf(buffer, "%d", game->snake.length);
+        text_set(&score_text, buffer, HMM_V2(0.0f, 0.0f), 30.0f);
+        score_length = game->snake.length;
+    }
+    push_text_mesh(Layer_Text, &score_text);
+    profile_end(Zone_Text);
+}
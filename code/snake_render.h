@@ -0,0 +1,146 @@
+#ifndef SNAKE_RENDER_H
+#define SNAKE_RENDER_H
+
+// GL drawing shared by the game and the benchmark. Everything here needs a
+// current GL 3.3 core context with glad loaded.
+
+#include <glad/glad.h>
+
+#define HANDMADE_MATH_USE_DEGREES
+#include "HandmadeMath.h"
+
+#include "snake_base.h"
+#include "snake_sim.h"
+#include "snake_atlas.h"
+
+#define SPRITE_COUNT_STRING "10"
+
+// Everything on screen is a quad cut from the sprite atlas. Quads are
+// queued with the push_ functions and go out in sprite_flush as one
+// instanced draw, back to front by layer and in submission order within a
+// layer.
+enum SpriteLayer {
+    Layer_Board,
+    Layer_Sprites,
+    Layer_Text,
+    Layer_Overlay,
+};
+
+// One quad as the sprite shader sees it, in pixels.
+struct SpriteInstance {
+    f32 x, y, w, h;
+    f32 u0, v0, u1, v1;
+    f32 rotation;  // degrees clockwise about the centre, as HMM_Rotate_LH
+    u32 sprite;    // SpriteId; the UV rect is relative to that sprite
+};
+
+// Text laid out once and kept. text_set only redoes the layout when the
+// string or its placement changes, and push_text_mesh copies the quads into
+// the frame's queue, so a string that stays the same costs a memcpy.
+struct TextMesh {
+    char *text;
+    HMM_Vec2 start;
+    f32 char_size;
+    SpriteInstance *sprites;
+    int count;
+    int capacity;  // bytes of text, and so glyph quads, there is room for
+};
+
+// Uniforms every shader looks up when it is created.
+enum ShaderUniform {
+    Uniform_Projection,
+    Uniform_SpriteRect,
+    Uniform_SpriteRepeat,
+    Uniform_Count,
+};
+
+#define PROGRAM_CACHE_MAGIC 0x534B4E53 // "SNKS"
+#define PROGRAM_CACHE_VERSION 1
+
+// A program binary cache file: this header, then the driver's binary.
+struct ProgramCacheHeader {
+    u32 magic;
+    u16 version;
+    u16 reserved;
+    u64 key;
+    u32 format;
+    u32 size;
+};
+
+struct Shader {
+    u32 program;
+    s32 locations[Uniform_Count];
+
+    // Last projection set, so an unchanged one is not sent again.
+    HMM_Mat4 projection;
+    b32 projection_set;
+};
+
+extern u32 quad_vbo;
+extern Shader sprite_shader;
+extern b32 program_binary_supported;
+extern u32 sprite_vao;
+extern u32 sprite_vbo;
+extern u32 sprite_atlas;
+
+// A thin cache over the bindings the renderer uses. Calls that would not
+// change anything are skipped, and profiler.stats counts both kinds. Code
+// that binds with raw GL calls gl_state_invalidate afterwards.
+void gl_state_invalidate();
+void gl_use_program(u32 program);
+void gl_bind_vertex_array(u32 vertex_array);
+void gl_bind_texture(u32 texture);
+void gl_bind_array_buffer(u32 buffer);
+void gl_set_blend(b32 enabled);
+
+// Call once after gladLoadGLLoader with the same loader.
+void gl_load_extensions(GLADloadproc load);
+
+u32 gl_shader_create(const char *vertex_src, const char *frag_src);
+u32 gl_shader_create_file(const char *vertex_name, const char *frag_name);
+// cache_path may be NULL to always compile.
+b32 shader_load(Shader *shader, const char *vertex_path, const char *frag_path, const char *cache_path);
+void shader_set_projection(Shader *shader, HMM_Mat4 projection);
+
+b32 render_init();
+b32 render_reload_shaders();
+
+void sprite_begin(HMM_Mat4 projection);
+void sprite_flush();
+
+void push_quad(SpriteLayer layer, HMM_Vec2 translation, HMM_Vec2 scale, f32 rotation, SpriteId id);
+void push_grid(SpriteLayer layer, HMM_Vec2 window_dim, f32 cell_size);
+void push_text(SpriteLayer layer, const char *text, HMM_Vec2 start, f32 char_size);
+// Saved just before a game_step so frames between ticks can draw the snake
+// part of the way there. Walls end the game rather than wrapping, so each
+// segment moves one cell a tick and the tail it left is all that is lost.
+struct SnakeTrail {
+    Cell tail;
+    int length;
+    u64 ticks;
+};
+
+void snake_trail_save(SnakeTrail *trail, GameState *game);
+// With a trail, segments are drawn blend (0 to 1) of the way from their
+// cells a tick ago to their cells now. trail may be NULL.
+void push_snake(SpriteLayer layer, Snake *snake, SnakeTrail *trail, f32 blend, f32 cell_size);
+
+void text_set(TextMesh *mesh, const char *text, HMM_Vec2 start, f32 char_size);
+void push_text_mesh(SpriteLayer layer, TextMesh *mesh);
+void text_free(TextMesh *mesh);
+
+// Copies the grid over the whole window straight away, in place of a
+// clear. The grid is drawn once into a framebuffer and only redrawn when the
+// window or cell size changes.
+void background_draw(HMM_Vec2 window_dim, f32 cell_size);
+
+// Copies in the background, then queues the apple, snake and score for one
+// frame of play. The snake is interpolated when trail was saved the tick
+// before the game's current one.
+void draw_play(GameState *game, SnakeTrail *trail, f32 blend, HMM_Vec2 window_dim, f32 cell_size,
+               f32 apple_rotation);
+
+HMM_Vec2 direction_vector(Dir dir);
+f32 direction_rotation(Dir dir);
+
+#endif // SNAKE_RENDER_H
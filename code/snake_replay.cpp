@@ -0,0 +1,187 @@
+#include "snake_replay.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(ReplayHeader) == 48, "ReplayHeader is stored on disk as is");
+
+static void writer_reserve(ReplayWriter *writer, u64 size) {
+    if (writer->size + size <= writer->capacity) return;
+    u64 capacity = writer->capacity ? writer->capacity : 4096;
+    while (capacity < writer->size + size) {
+        capacity *= 2;
+    }
+    writer->data = (u8 *)realloc(writer->data, capacity);
+    writer->capacity = capacity;
+}
+
+static void write_varint(ReplayWriter *writer, u64 value) {
+    writer_reserve(writer, 10);
+    while (value >= 0x80) {
+        writer->data[writer->size++] = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    writer->data[writer->size++] = (u8)value;
+}
+
+static b32 read_varint(const u8 **at, const u8 *end, u64 *value) {
+    u64 result = 0;
+    for (int shift = 0; shift < 64 && *at < end; shift += 7) {
+        u8 byte = *(*at)++;
+        result |= (u64)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// state must have just been reset with seed.
+void replay_begin(ReplayWriter *writer, GameState *state, u64 seed) {
+    writer_reserve(writer, sizeof(ReplayHeader));
+    writer->record_start = writer->size;
+
+    ReplayHeader header{};
+    header.magic = REPLAY_MAGIC;
+    header.version = REPLAY_VERSION;
+    header.width = state->board.width;
+    header.height = state->board.height;
+    header.seed = seed;
+    memcpy(writer->data + writer->size, &header, sizeof(header));
+    writer->size += sizeof(header);
+
+    writer->last_tick = 0;
+    writer->last_dir = state->dir;
+}
+
+// Call after every game_step. Only direction changes are written.
+void replay_record(ReplayWriter *writer, GameState *state) {
+    if (state->dir == writer->last_dir) return;
+    u64 tick = state->ticks - 1;
+    write_varint(writer, ((tick - writer->last_tick) << 2) | (u64)(state->dir - 1));
+    writer->last_tick = tick;
+    writer->last_dir = state->dir;
+}
+
+void replay_finish(ReplayWriter *writer, GameState *state) {
+    ReplayHeader header;
+    memcpy(&header, writer->data + writer->record_start, sizeof(header));
+    header.ticks = state->ticks;
+    header.length = state->snake.length;
+    header.status = (u8)state->status;
+    header.cause = (u8)state->cause;
+    header.stream_size = (u32)(writer->size - writer->record_start - sizeof(header));
+    memcpy(writer->data + writer->record_start, &header, sizeof(header));
+}
+
+// Writes every finished record in the buffer and empties it.
+b32 replay_write_file(ReplayWriter *writer, const char *path, b32 append) {
+    FILE *file = fopen(path, append ? "ab" : "wb");
+    if (file == NULL) {
+        printf("Failed to open replay file: %s\n", path);
+        return false;
+    }
+    b32 ok = fwrite(writer->data, 1, writer->size, file) == writer->size;
+    fclose(file);
+    if (!ok) {
+        printf("Failed to write replay file: %s\n", path);
+    }
+    writer->size = 0;
+    return ok;
+}
+
+void replay_writer_free(ReplayWriter *writer) {
+    free(writer->data);
+    *writer = {};
+}
+
+b32 replay_open(ReplayFile *file, const char *path) {
+    *file = {};
+    file->data = (const u8 *)platform_map_file(path, &file->size);
+    if (file->data == NULL) {
+        printf("Failed to open replay file: %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Steps to the next record. Stops at the end of the file or at the first
+// record that does not look valid.
+b32 replay_next(ReplayFile *file, ReplayRecord *record) {
+    if (file->size - file->offset < sizeof(ReplayHeader)) return false;
+
+    // Records are packed back to back, so copy the header out rather than
+    // reading it in place unaligned.
+    ReplayHeader header;
+    memcpy(&header, file->data + file->offset, sizeof(header));
+    if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION) {
+        printf("Bad replay record at offset %llu\n", (unsigned long long)file->offset);
+        return false;
+    }
+    if (header.width == 0 || header.height == 0 || (u64)header.width * header.height > REPLAY_MAX_CELLS) {
+        printf("Bad replay board %ux%u at offset %llu\n", header.width, header.height, (unsigned long long)file->offset);
+        return false;
+    }
+    u64 record_size = sizeof(ReplayHeader) + header.stream_size;
+    if (file->size - file->offset < record_size) {
+        printf("Truncated replay record at offset %llu\n", (unsigned long long)file->offset);
+        return false;
+    }
+
+    record->header = header;
+    record->stream = file->data + file->offset + sizeof(ReplayHeader);
+    file->offset += record_size;
+    return true;
+}
+
+void replay_close(ReplayFile *file) {
+    if (file->data) {
+        platform_unmap_file(file->data, file->size);
+    }
+    *file = {};
+}
+
+static void cursor_advance(ReplayCursor *cursor) {
+    u64 value;
+    if (!read_varint(&cursor->at, cursor->end, &value)) {
+        cursor->next_tick = ~0ull;
+        cursor->next_dir = (Dir)0;
+        return;
+    }
+    cursor->next_tick += value >> 2;
+    cursor->next_dir = (Dir)((value & 3) + 1);
+}
+
+void replay_cursor_init(ReplayCursor *cursor, ReplayRecord *record) {
+    cursor->at = record->stream;
+    cursor->end = record->stream + record->header.stream_size;
+    cursor->next_tick = 0;
+    cursor_advance(cursor);
+}
+
+// The turn to feed game_step on the given tick, or 0 to keep going.
+Dir replay_cursor_turn(ReplayCursor *cursor, u64 tick) {
+    if (tick != cursor->next_tick) return (Dir)0;
+    Dir dir = cursor->next_dir;
+    cursor_advance(cursor);
+    return dir;
+}
+
+b32 replay_play(ReplayRecord *record, GameState *state) {
+    const ReplayHeader *header = &record->header;
+    game_reset(state, header->seed);
+
+    ReplayCursor cursor;
+    replay_cursor_init(&cursor, record);
+    while (state->status == Game_Playing && state->ticks < header->ticks) {
+        SimInput input{};
+        input.turn = replay_cursor_turn(&cursor, state->ticks);
+        game_step(state, input);
+    }
+
+    return state->ticks == header->ticks &&
+           (u32)state->snake.length == header->length &&
+           (u8)state->status == header->status;
+}
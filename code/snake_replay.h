@@ -0,0 +1,77 @@
+#ifndef SNAKE_REPLAY_H
+#define SNAKE_REPLAY_H
+
+// Replays store a game's seed and board size plus the ticks at which its
+// direction changed. Each change is one varint of (tick delta << 2 | dir - 1),
+// so a typical game is a few hundred bytes. A replay file is any number of
+// records back to back; playback maps the file and re-simulates each record
+// with game_step, checking the result against the header.
+
+#include "snake_sim.h"
+
+#define REPLAY_MAGIC 0x524B4E53 // "SNKR"
+#define REPLAY_VERSION 2 // bumped whenever the same seed and turns play out differently
+// A record's board must have 1 to REPLAY_MAX_CELLS cells.
+#define REPLAY_MAX_CELLS (1u << 30)
+
+struct ReplayHeader {
+    u32 magic;
+    u16 version;
+    u16 flags;
+    u32 width;
+    u32 height;
+    u64 seed;
+    u64 ticks;
+    u32 length;
+    u8 status;
+    u8 cause;
+    u16 reserved;
+    u32 stream_size;
+    u32 reserved2;
+};
+
+struct ReplayWriter {
+    u8 *data;
+    u64 size;
+    u64 capacity;
+    u64 record_start;
+    u64 last_tick;
+    Dir last_dir;
+};
+
+struct ReplayRecord {
+    ReplayHeader header;
+    const u8 *stream;
+};
+
+struct ReplayCursor {
+    const u8 *at;
+    const u8 *end;
+    u64 next_tick;
+    Dir next_dir;
+};
+
+struct ReplayFile {
+    const u8 *data;
+    u64 size;
+    u64 offset;
+};
+
+void replay_begin(ReplayWriter *writer, GameState *state, u64 seed);
+void replay_record(ReplayWriter *writer, GameState *state);
+void replay_finish(ReplayWriter *writer, GameState *state);
+b32 replay_write_file(ReplayWriter *writer, const char *path, b32 append);
+void replay_writer_free(ReplayWriter *writer);
+
+b32 replay_open(ReplayFile *file, const char *path);
+b32 replay_next(ReplayFile *file, ReplayRecord *record);
+void replay_close(ReplayFile *file);
+
+void replay_cursor_init(ReplayCursor *cursor, ReplayRecord *record);
+Dir replay_cursor_turn(ReplayCursor *cursor, u64 tick);
+
+// Re-simulates a record into state, which must already be initialised for
+// the record's board size. Returns true if the outcome matches the header.
+b32 replay_play(ReplayRecord *record, GameState *state);
+
+#endif // SNAKE_REPLAY_H
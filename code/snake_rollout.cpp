@@ -0,0 +1,427 @@
+#include "snake_rollout.h"
+#include "snake_replay.h"
+#include "snake_autopilot.h"
+#include "snake_mcts.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static b32 move_is_safe(GameState *state, Dir dir) {
+    if (dir == dir_opposite(state->dir)) return false;
+    Cell next = snake_next_head(&state->snake, dir);
+    return !board_test(&state->board, next.x, next.y);
+}
+
+//
+// Policies
+//
+
+// Uniform over the moves that survive the next tick. Draws from a stream
+// jumped away from the game's own so turns and apples stay uncorrelated.
+static void *random_create(const RolloutConfig *config) {
+    (void)config;
+    return calloc(1, sizeof(Rng));
+}
+
+static void random_begin_game(void *context, u64 seed) {
+    rng_seed((Rng *)context, seed);
+    rng_jump((Rng *)context);
+}
+
+static Dir random_choose(void *context, GameState *state) {
+    Dir safe[4];
+    int count = 0;
+    for (int dir = Left; dir <= Down; dir++) {
+        if (move_is_safe(state, (Dir)dir)) safe[count++] = (Dir)dir;
+    }
+    if (count == 0) return state->dir;
+    return safe[rng_below((Rng *)context, count)];
+}
+
+static void random_destroy(void *context) {
+    free(context);
+}
+
+// Heads for the apple along whichever axis is off, falling back to any move
+// that does not die on the next tick.
+static Dir greedy_choose(void *context, GameState *state) {
+    (void)context;
+    Cell *head = snake_cell(&state->snake, 0);
+    Dir wanted[5];
+    int count = 0;
+    if (state->apple.x < head->x) wanted[count++] = Left;
+    if (state->apple.x > head->x) wanted[count++] = Right;
+    if (state->apple.y > head->y) wanted[count++] = Up;
+    if (state->apple.y < head->y) wanted[count++] = Down;
+    wanted[count++] = state->dir;
+
+    for (int i = 0; i < count; i++) {
+        if (move_is_safe(state, wanted[i])) return wanted[i];
+    }
+    for (int dir = Left; dir <= Down; dir++) {
+        if (move_is_safe(state, (Dir)dir)) return (Dir)dir;
+    }
+    return state->dir;
+}
+
+static void *astar_create(const RolloutConfig *config) {
+    Autopilot *autopilot = (Autopilot *)malloc(sizeof(Autopilot));
+    autopilot_create(autopilot, config->width, config->height);
+    return autopilot;
+}
+
+static Dir astar_choose(void *context, GameState *state) {
+    return autopilot_choose((Autopilot *)context, state);
+}
+
+static void astar_destroy(void *context) {
+    autopilot_free((Autopilot *)context);
+    free(context);
+}
+
+// Each worker owns a whole search tree and its own search threads, so
+// --threads times --search-threads cores are busy.
+static void *mcts_policy_create(const RolloutConfig *config) {
+    MctsConfig mcts_config = mcts_default_config();
+    mcts_config.threads = config->search_threads;
+    mcts_config.budget_ns = (u64)(config->search_ms * 1000000.0);
+    Mcts *mcts = new Mcts;
+    mcts_create(mcts, config->width, config->height, &mcts_config);
+    return mcts;
+}
+
+static void mcts_policy_begin_game(void *context, u64 seed) {
+    mcts_seed((Mcts *)context, seed);
+}
+
+static Dir mcts_policy_choose(void *context, GameState *state) {
+    return mcts_choose((Mcts *)context, state);
+}
+
+static void mcts_policy_destroy(void *context) {
+    mcts_free((Mcts *)context);
+    delete (Mcts *)context;
+}
+
+static const Policy policies[] = {
+    {"random", random_create, random_begin_game, random_choose, random_destroy},
+    {"greedy", NULL, NULL, greedy_choose, NULL},
+    {"astar", astar_create, NULL, astar_choose, astar_destroy},
+    {"mcts", mcts_policy_create, mcts_policy_begin_game, mcts_policy_choose, mcts_policy_destroy},
+};
+
+const Policy *find_policy(const char *name) {
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        if (strcmp(policies[i].name, name) == 0) return &policies[i];
+    }
+    return NULL;
+}
+
+void list_policies() {
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        printf("%s%s", i ? ", " : "", policies[i].name);
+    }
+    printf("\n");
+}
+
+//
+// Work stealing
+//
+
+// A worker's remaining game ids [begin, end), packed into one word so the
+// owner taking from the front and thieves splitting off the back race on a
+// single compare-and-swap. Padded so neighbouring workers do not share
+// cache lines.
+struct WorkRange {
+    std::atomic<u64> range;
+    u8 pad[56];
+};
+
+struct Worker {
+    RolloutConfig *config;
+    WorkRange *queues;
+    int index;
+    RolloutStats stats;
+    ReplayWriter replay;
+    char replay_path[512];
+    u8 pad[64];
+};
+
+inline u64 pack_range(u32 begin, u32 end) {
+    return ((u64)end << 32) | begin;
+}
+
+static b32 take_own(WorkRange *queue, u32 *game) {
+    u64 range = queue->range.load(std::memory_order_relaxed);
+    for (;;) {
+        u32 begin = (u32)range;
+        u32 end = (u32)(range >> 32);
+        if (begin >= end) return false;
+        if (queue->range.compare_exchange_weak(range, pack_range(begin + 1, end), std::memory_order_acquire)) {
+            *game = begin;
+            return true;
+        }
+    }
+}
+
+// Moves the back half of the victim's range into the thief's empty range.
+static b32 steal(WorkRange *victim, WorkRange *thief) {
+    u64 range = victim->range.load(std::memory_order_relaxed);
+    for (;;) {
+        u32 begin = (u32)range;
+        u32 end = (u32)(range >> 32);
+        if (begin >= end) return false;
+        u32 mid = end - (end - begin + 1) / 2;
+        if (victim->range.compare_exchange_weak(range, pack_range(begin, mid), std::memory_order_acquire)) {
+            thief->range.store(pack_range(mid, end), std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+#define REPLAY_FLUSH_SIZE (16 * 1024 * 1024)
+
+// Game n of a run with seed S always plays the same way, whatever thread
+// picks it up, so a single game can be re-run with --start-game n --games 1.
+u64 rollout_game_seed(u64 seed, u32 game) {
+    u64 state = seed ^ ((u64)game << 32);
+    return splitmix64(&state);
+}
+
+static void play_game(Worker *worker, GameState *state, void *context, u32 game) {
+    RolloutConfig *config = worker->config;
+    const Policy *policy = config->policy;
+
+    u64 game_seed = rollout_game_seed(config->seed, game);
+
+    game_reset(state, game_seed);
+    if (policy->begin_game) policy->begin_game(context, game_seed);
+    if (config->record_path) replay_begin(&worker->replay, state, game_seed);
+    while (state->status == Game_Playing) {
+        if (config->max_ticks && state->ticks >= config->max_ticks) break;
+        SimInput input{};
+        input.turn = policy->choose(context, state);
+        game_step(state, input);
+        if (config->record_path) replay_record(&worker->replay, state);
+    }
+    if (config->record_path) {
+        replay_finish(&worker->replay, state);
+        if (worker->replay.size >= REPLAY_FLUSH_SIZE) {
+            replay_write_file(&worker->replay, worker->replay_path, true);
+        }
+    }
+
+    RolloutStats *stats = &worker->stats;
+    stats->games++;
+    stats->total_length += state->snake.length;
+    stats->total_ticks += state->ticks;
+    if (state->snake.length > stats->max_length) stats->max_length = state->snake.length;
+    if (stats->games == 1 || state->snake.length < stats->min_length) {
+        stats->min_length = state->snake.length;
+        stats->worst_game = game;
+    }
+    if (state->ticks > stats->max_ticks) stats->max_ticks = state->ticks;
+    if (state->status == Game_Won) stats->won++;
+    else if (state->cause == Death_Wall) stats->wall_deaths++;
+    else if (state->cause == Death_Body) stats->body_deaths++;
+    else stats->timed_out++;
+}
+
+static void worker_run(Worker *worker) {
+    RolloutConfig *config = worker->config;
+    WorkRange *own = &worker->queues[worker->index];
+
+    GameState state;
+    game_init(&state, config->width, config->height, 0);
+    void *context = config->policy->create ? config->policy->create(config) : NULL;
+
+    // One archive per worker, so recording never shares a file handle.
+    if (config->record_path) {
+        if (config->threads == 1) {
+            snprintf(worker->replay_path, sizeof(worker->replay_path), "%s", config->record_path);
+        } else {
+            snprintf(worker->replay_path, sizeof(worker->replay_path), "%s.%d", config->record_path, worker->index);
+        }
+        replay_write_file(&worker->replay, worker->replay_path, false);
+    }
+
+    for (;;) {
+        u32 game;
+        while (take_own(own, &game)) {
+            play_game(worker, &state, context, game);
+        }
+
+        b32 stole = false;
+        for (int i = 1; i < config->threads && !stole; i++) {
+            WorkRange *victim = &worker->queues[(worker->index + i) % config->threads];
+            stole = steal(victim, own);
+        }
+        if (!stole) break;
+        worker->stats.steals++;
+    }
+
+    if (config->record_path) {
+        replay_write_file(&worker->replay, worker->replay_path, true);
+        replay_writer_free(&worker->replay);
+    }
+    if (config->policy->destroy) config->policy->destroy(context);
+    game_free(&state);
+}
+
+RolloutStats run_rollouts(RolloutConfig *config) {
+    int threads = config->threads;
+    WorkRange *queues = new WorkRange[threads];
+    Worker *workers = new Worker[threads];
+
+    u32 per_thread = config->games / threads;
+    u32 extra = config->games % threads;
+    u32 begin = config->start_game;
+    for (int i = 0; i < threads; i++) {
+        u32 count = per_thread + (i < (int)extra ? 1 : 0);
+        queues[i].range.store(pack_range(begin, begin + count));
+        begin += count;
+
+        workers[i].config = config;
+        workers[i].queues = queues;
+        workers[i].index = i;
+        workers[i].stats = {};
+        workers[i].replay = {};
+    }
+
+    std::thread *handles = new std::thread[threads];
+    for (int i = 1; i < threads; i++) {
+        handles[i] = std::thread(worker_run, &workers[i]);
+    }
+    worker_run(&workers[0]);
+    for (int i = 1; i < threads; i++) {
+        handles[i].join();
+    }
+
+    RolloutStats total{};
+    b32 have_min = false;
+    for (int i = 0; i < threads; i++) {
+        RolloutStats *stats = &workers[i].stats;
+        total.games += stats->games;
+        total.total_length += stats->total_length;
+        total.total_ticks += stats->total_ticks;
+        if (stats->max_length > total.max_length) total.max_length = stats->max_length;
+        if (stats->games && (!have_min || stats->min_length < total.min_length)) {
+            have_min = true;
+            total.min_length = stats->min_length;
+            total.worst_game = stats->worst_game;
+        }
+        if (stats->max_ticks > total.max_ticks) total.max_ticks = stats->max_ticks;
+        total.wall_deaths += stats->wall_deaths;
+        total.body_deaths += stats->body_deaths;
+        total.won += stats->won;
+        total.timed_out += stats->timed_out;
+        total.steals += stats->steals;
+    }
+
+    delete[] handles;
+    delete[] workers;
+    delete[] queues;
+    return total;
+}
+
+//
+// Command line
+//
+
+static void print_usage() {
+    printf("usage: --headless [--games N] [--threads T] [--seed S] [--policy NAME]\n"
+           "                  [--width W] [--height H] [--max-ticks M] [--start-game N]\n"
+           "                  [--record PATH] [--search-threads N] [--search-ms MS]\n"
+           "policies: ");
+    list_policies();
+}
+
+int rollout_main(int argc, char **argv) {
+    RolloutConfig config{};
+    config.games = 1000;
+    config.threads = (int)std::thread::hardware_concurrency();
+    config.seed = 1;
+    config.width = 35;
+    config.height = 20;
+    config.max_ticks = 0;
+    config.policy = find_policy("greedy");
+    config.search_threads = 1;
+    config.search_ms = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--headless") == 0) {
+            continue;
+        } else if (strcmp(arg, "--help") == 0) {
+            print_usage();
+            return 0;
+        } else if (value == NULL) {
+            printf("Missing value for %s\n", arg);
+            print_usage();
+            return 1;
+        }
+
+        i++;
+        if (strcmp(arg, "--games") == 0) {
+            config.games = (u32)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--threads") == 0) {
+            config.threads = atoi(value);
+        } else if (strcmp(arg, "--start-game") == 0) {
+            config.start_game = (u32)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--record") == 0) {
+            config.record_path = value;
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoull(value, NULL, 0);
+        } else if (strcmp(arg, "--width") == 0) {
+            config.width = atoi(value);
+        } else if (strcmp(arg, "--height") == 0) {
+            config.height = atoi(value);
+        } else if (strcmp(arg, "--search-threads") == 0) {
+            config.search_threads = atoi(value);
+        } else if (strcmp(arg, "--search-ms") == 0) {
+            config.search_ms = atof(value);
+        } else if (strcmp(arg, "--max-ticks") == 0) {
+            config.max_ticks = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--policy") == 0) {
+            config.policy = find_policy(value);
+            if (config.policy == NULL) {
+                printf("Unknown policy: %s\n", value);
+                print_usage();
+                return 1;
+            }
+        } else {
+            printf("Unknown option: %s\n", arg);
+            print_usage();
+            return 1;
+        }
+    }
+    if (config.threads < 1) config.threads = 1;
+    if (config.width < 2 || config.height < 2) {
+        printf("Board must be at least 2x2\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    RolloutStats stats = run_rollouts(&config);
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    f64 games = stats.games ? (f64)stats.games : 1.0;
+    printf("%llu games, %d threads, policy %s, board %dx%d, seed %llu\n",
+           (unsigned long long)stats.games, config.threads, config.policy->name,
+           config.width, config.height, (unsigned long long)config.seed);
+    printf("length: avg %.2f, max %d, min %d (game %u)\n", stats.total_length / games, stats.max_length,
+           stats.min_length, stats.worst_game);
+    printf("ticks:  avg %.1f, max %llu\n", stats.total_ticks / games, (unsigned long long)stats.max_ticks);
+    printf("end:    wall %llu, body %llu, won %llu, timed out %llu\n",
+           (unsigned long long)stats.wall_deaths, (unsigned long long)stats.body_deaths,
+           (unsigned long long)stats.won, (unsigned long long)stats.timed_out);
+    printf("%.3f s, %.0f games/s, %.0f ticks/s, %llu steals\n", seconds, stats.games / seconds,
+           stats.total_ticks / seconds, (unsigned long long)stats.steals);
+    return 0;
+}
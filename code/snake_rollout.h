@@ -0,0 +1,61 @@
+#ifndef SNAKE_ROLLOUT_H
+#define SNAKE_ROLLOUT_H
+
+// Headless whole-game rollouts spread over worker threads. Each worker owns
+// a range of game ids and steals half of another worker's range when its own
+// runs dry. Results are accumulated per worker and merged after the join.
+
+#include "snake_sim.h"
+
+struct RolloutConfig;
+
+// A policy picks the next turn for a game. create/destroy may be NULL; the
+// context they return is private to one worker thread.
+struct Policy {
+    const char *name;
+    void *(*create)(const RolloutConfig *config);
+    void (*begin_game)(void *context, u64 seed);
+    Dir (*choose)(void *context, GameState *state);
+    void (*destroy)(void *context);
+};
+
+struct RolloutConfig {
+    u32 games;
+    u32 start_game;
+    int threads;
+    u64 seed;
+    int width;
+    int height;
+    u64 max_ticks; // 0 for no limit
+    const Policy *policy;
+    const char *record_path; // NULL to skip recording
+    int search_threads;      // per game, for searching policies
+    f64 search_ms;           // per move, for searching policies
+};
+
+struct RolloutStats {
+    u64 games;
+    u64 total_length;
+    u64 total_ticks;
+    int max_length;
+    int min_length;
+    u32 worst_game;
+    u64 max_ticks;
+    u64 wall_deaths;
+    u64 body_deaths;
+    u64 won;
+    u64 timed_out;
+    u64 steals;
+};
+
+const Policy *find_policy(const char *name);
+void list_policies();
+
+u64 rollout_game_seed(u64 seed, u32 game);
+RolloutStats run_rollouts(RolloutConfig *config);
+
+// Parses --games/--threads/--seed/--policy/--width/--height/--max-ticks/--start-game/--record
+// and --search-threads/--search-ms, runs the rollouts and prints the merged results.
+int rollout_main(int argc, char **argv);
+
+#endif // SNAKE_ROLLOUT_H
@@ -0,0 +1,545 @@
+#include "snake_sim.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define INITIAL_CELLS 64
+#define SNAKE_MAX_CAPACITY (1u << 30)
+#define ARENA_COMMIT_SIZE (64 * 1024)
+
+u64 splitmix64(u64 *state) {
+    u64 z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *rng, u64 seed) {
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+inline u64 rotl(u64 x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+u64 rng_next(Rng *rng) {
+    u64 *s = rng->s;
+    u64 result = rotl(s[1] * 5, 7) * 9;
+    u64 t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// Multiply-shift instead of modulo; the bias is negligible below 2^32.
+u32 rng_below(Rng *rng, u32 count) {
+    return (u32)(((rng_next(rng) >> 32) * count) >> 32);
+}
+
+void rng_jump(Rng *rng) {
+    static const u64 jump[] = {0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull};
+    u64 s[4] = {};
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (1ull << b)) {
+                s[0] ^= rng->s[0];
+                s[1] ^= rng->s[1];
+                s[2] ^= rng->s[2];
+                s[3] ^= rng->s[3];
+            }
+            rng_next(rng);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = s[i];
+    }
+}
+
+// Returns the current stream and moves rng 2^128 steps past it.
+Rng rng_split(Rng *rng) {
+    Rng result = *rng;
+    rng_jump(rng);
+    return result;
+}
+
+void *platform_reserve(u64 size) {
+#if defined(_WIN32)
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void *result = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return (result == MAP_FAILED) ? NULL : result;
+#endif
+}
+
+b32 platform_commit(void *ptr, u64 size) {
+#if defined(_WIN32)
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+void platform_release(void *ptr, u64 size) {
+#if defined(_WIN32)
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
+
+// Maps a whole file read-only. Returns NULL for missing or empty files.
+const void *platform_map_file(const char *path, u64 *size) {
+    *size = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return NULL;
+    void *result = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (result) *size = (u64)file_size.QuadPart;
+    return result;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *result = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (result == MAP_FAILED) return NULL;
+    *size = (u64)st.st_size;
+    return result;
+#endif
+}
+
+void platform_unmap_file(const void *ptr, u64 size) {
+#if defined(_WIN32)
+    UnmapViewOfFile(ptr);
+#else
+    munmap((void *)ptr, size);
+#endif
+}
+
+MemoryArena arena_create(u64 reserve_size) {
+    MemoryArena arena{};
+    reserve_size = (reserve_size + ARENA_COMMIT_SIZE - 1) & ~(u64)(ARENA_COMMIT_SIZE - 1);
+    arena.base = (u8 *)platform_reserve(reserve_size);
+    if (arena.base == NULL) {
+        printf("Failed to reserve %llu bytes\n", (unsigned long long)reserve_size);
+        return arena;
+    }
+    arena.reserved = reserve_size;
+    return arena;
+}
+
+// Returns zeroed memory, or NULL once the reservation is exhausted.
+void *arena_push(MemoryArena *arena, u64 size) {
+    u64 new_used = (arena->used + size + 15) & ~(u64)15;
+    if (new_used > arena->reserved) {
+        printf("Arena out of memory: %llu of %llu bytes used\n", (unsigned long long)arena->used, (unsigned long long)arena->reserved);
+        return NULL;
+    }
+    if (new_used > arena->committed) {
+        u64 new_committed = (new_used + ARENA_COMMIT_SIZE - 1) & ~(u64)(ARENA_COMMIT_SIZE - 1);
+        if (new_committed > arena->reserved) new_committed = arena->reserved;
+        if (!platform_commit(arena->base + arena->committed, new_committed - arena->committed)) {
+            printf("Failed to commit arena memory\n");
+            return NULL;
+        }
+        arena->committed = new_committed;
+    }
+    void *result = arena->base + arena->used;
+    arena->used = new_used;
+    return result;
+}
+
+void arena_release(MemoryArena *arena) {
+    if (arena->base) {
+        platform_release(arena->base, arena->reserved);
+    }
+    *arena = {};
+}
+
+void arena_report(const char *name, MemoryArena *arena) {
+    printf("%s: %llu KB used, %llu KB committed, %llu KB reserved\n", name,
+           (unsigned long long)(arena->used / 1024),
+           (unsigned long long)(arena->committed / 1024),
+           (unsigned long long)(arena->reserved / 1024));
+}
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+inline int bits_popcount(u64 x) { return (int)__popcnt64(x); }
+inline int bits_lowest(u64 x) { unsigned long index; _BitScanForward64(&index, x); return (int)index; }
+#else
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+inline int bits_popcount(u64 x) { return __builtin_popcountll(x); }
+inline int bits_lowest(u64 x) { return __builtin_ctzll(x); }
+#endif
+
+static int board_word_count(Board *board) {
+    return (board->stride * (board->height + 2) + 63) / 64;
+}
+
+// Arena bytes board_create takes for this size, alignment included.
+u64 board_storage_size(int width, int height) {
+    u64 word_count = ((u64)(width + 2) * (u64)(height + 2) + 63) / 64;
+    u64 block_count = (word_count + BOARD_BLOCK_WORDS - 1) / BOARD_BLOCK_WORDS;
+    return word_count * sizeof(u64) + block_count * sizeof(int) + 32;
+}
+
+Board board_create(MemoryArena *arena, int width, int height) {
+    Board board{};
+    board.width = width;
+    board.height = height;
+    board.stride = width + 2;
+    int word_count = board_word_count(&board);
+    int block_count = (word_count + BOARD_BLOCK_WORDS - 1) / BOARD_BLOCK_WORDS;
+    board.bits = (u64 *)arena_push(arena, word_count * sizeof(u64));
+    board.block_free = (int *)arena_push(arena, block_count * sizeof(int));
+    board_reset(&board);
+    return board;
+}
+
+void board_reset(Board *board) {
+    int bit_count = board->stride * (board->height + 2);
+    int word_count = board_word_count(board);
+    memset(board->bits, 0, word_count * sizeof(u64));
+    for (int x = -1; x <= board->width; x++) {
+        board_set(board, x, -1);
+        board_set(board, x, board->height);
+    }
+    for (int y = 0; y < board->height; y++) {
+        board_set(board, -1, y);
+        board_set(board, board->width, y);
+    }
+    if (bit_count & 63) {
+        board->bits[word_count - 1] |= ~0ull << (bit_count & 63);
+    }
+
+    for (int word = 0; word < word_count; word++) {
+        if (word % BOARD_BLOCK_WORDS == 0) board->block_free[word / BOARD_BLOCK_WORDS] = 0;
+        board->block_free[word / BOARD_BLOCK_WORDS] += 64 - bits_popcount(board->bits[word]);
+    }
+    board->free_count = board->width * board->height;
+}
+
+// Marks an in-bounds cell as taken by the snake.
+void board_occupy(Board *board, int x, int y) {
+    board_set(board, x, y);
+    board->block_free[board_index(board, x, y) / (64 * BOARD_BLOCK_WORDS)]--;
+    board->free_count--;
+}
+
+void board_vacate(Board *board, int x, int y) {
+    board_clear(board, x, y);
+    board->block_free[board_index(board, x, y) / (64 * BOARD_BLOCK_WORDS)]++;
+    board->free_count++;
+}
+
+// The body never outgrows the board, so max_length is the board's cell count.
+// Only the address space is reserved up front. Ring indices are ints, so the
+// capacity stops at SNAKE_MAX_CAPACITY.
+Snake snake_create(MemoryArena *arena, int max_length) {
+    Snake snake{};
+    u64 max_capacity = INITIAL_CELLS;
+    while (max_capacity < (u64)max_length && max_capacity < SNAKE_MAX_CAPACITY) {
+        max_capacity *= 2;
+    }
+    *arena = arena_create(max_capacity * sizeof(Cell));
+    snake.arena = arena;
+    snake.max_capacity = (int)max_capacity;
+    snake.capacity = INITIAL_CELLS;
+    snake.cells = (Cell *)arena_push(arena, snake.capacity * sizeof(Cell));
+    snake.head = snake.capacity - 1;
+    return snake;
+}
+
+// Keeps whatever capacity the ring has already grown to.
+void snake_reset(Snake *snake) {
+    snake->head = snake->capacity - 1;
+    snake->length = 0;
+}
+
+// Doubles the ring in place. The arena only ever holds the body, so the new
+// half is contiguous with the old one; cells that had wrapped around to the
+// start are moved up past the old end to keep the body in order.
+// Running out of memory here is fatal: the ring would otherwise wrap onto
+// its own tail.
+static void snake_grow_capacity(Snake *snake) {
+    int old_capacity = snake->capacity;
+    if (arena_push(snake->arena, (u64)old_capacity * sizeof(Cell)) == NULL) {
+        printf("Failed to grow the snake past %d cells\n", old_capacity);
+        abort();
+    }
+    snake->capacity = old_capacity * 2;
+
+    int tail = (snake->head - (snake->length - 1)) & (old_capacity - 1);
+    if (snake->length > 0 && tail > snake->head) {
+        memcpy(snake->cells + old_capacity, snake->cells, (snake->head + 1) * sizeof(Cell));
+        snake->head += old_capacity;
+    }
+}
+
+// Grows an empty ring to hold at least capacity cells.
+void snake_reserve(Snake *snake, int capacity) {
+    snake->length = 0;
+    while (snake->capacity < capacity && snake->capacity < snake->max_capacity) {
+        snake_grow_capacity(snake);
+    }
+    snake->head = snake->capacity - 1;
+}
+
+void snake_push_head(Snake *snake, Cell cell) {
+    if (snake->length == snake->capacity && snake->capacity < snake->max_capacity) {
+        snake_grow_capacity(snake);
+    }
+    snake->head = (snake->head + 1) & (snake->capacity - 1);
+    snake->cells[snake->head] = cell;
+    snake->length++;
+}
+
+void snake_pop_tail(Snake *snake) {
+    snake->length--;
+}
+
+Cell snake_next_head(Snake *snake, Dir dir) {
+    Cell head = *snake_cell(snake, 0);
+    head.x += (dir==Left) ? -1 : (dir==Right) ? 1 : 0;
+    head.y += (dir==Down) ? -1 : (dir==Up) ? 1 : 0;
+    head.dir = dir;
+    return head;
+}
+
+// Moves the snake one cell in dir. The tail stays in place when growing.
+// Returns true if the head ran into a wall or the body.
+b32 snake_step(Snake *snake, Board *board, Dir dir, b32 grow) {
+    Cell head = snake_next_head(snake, dir);
+    if (!grow) {
+        Cell *tail = snake_cell(snake, snake->length - 1);
+        board_vacate(board, tail->x, tail->y);
+        snake_pop_tail(snake);
+    }
+    b32 dead = board_test(board, head.x, head.y);
+    snake_push_head(snake, head);
+    if (!dead) {
+        board_occupy(board, head.x, head.y);
+    }
+    return dead;
+}
+
+// Picks a uniformly random free cell: the k-th clear bit for a random k,
+// found by skipping whole blocks, then whole words. Returns false when the
+// board is full.
+b32 spawn_apple(Board *board, Rng *rng, Cell *apple) {
+    if (board->free_count == 0) {
+        return false;
+    }
+    int rank = (int)rng_below(rng, board->free_count);
+    int block = 0;
+    while (rank >= board->block_free[block]) {
+        rank -= board->block_free[block++];
+    }
+    int word = block * BOARD_BLOCK_WORDS;
+    for (;;) {
+        int free = 64 - bits_popcount(board->bits[word]);
+        if (rank < free) break;
+        rank -= free;
+        word++;
+    }
+    u64 clear = ~board->bits[word];
+#if defined(__BMI2__)
+    clear = _pdep_u64(1ull << rank, clear);
+#else
+    for (; rank > 0; rank--) {
+        clear &= clear - 1;
+    }
+#endif
+    int index = word * 64 + bits_lowest(clear);
+    apple->x = index % board->stride - 1;
+    apple->y = index / board->stride - 1;
+    return true;
+}
+
+Dir dir_opposite(Dir dir) {
+    switch (dir) {
+    case Left:
+        return Right;
+    case Right:
+        return Left;
+    case Up:
+        return Down;
+    case Down:
+        return Up;
+    }
+    return (Dir)0;
+}
+
+void game_init(GameState *state, int width, int height, u64 seed) {
+    *state = {};
+    state->board_arena = arena_create(board_storage_size(width, height));
+    state->board = board_create(&state->board_arena, width, height);
+    state->snake = snake_create(&state->snake_arena, width * height);
+    game_reset(state, seed);
+}
+
+void game_reset(GameState *state, u64 seed) {
+    board_reset(&state->board);
+    snake_reset(&state->snake);
+    rng_seed(&state->rng, seed);
+
+    int start_y = state->board.height > 4 ? 4 : 0;
+    snake_push_head(&state->snake, Cell(0, start_y, Right));
+    board_occupy(&state->board, 0, start_y);
+
+    state->dir = Right;
+    state->status = Game_Playing;
+    state->cause = Death_None;
+    state->ticks = 0;
+    spawn_apple(&state->board, &state->rng, &state->apple);
+}
+
+void game_free(GameState *state) {
+    arena_release(&state->board_arena);
+    arena_release(&state->snake_arena);
+    *state = {};
+}
+
+// Advances the game by one tick. A turn straight back into the body is
+// ignored and the snake keeps its current direction.
+GameStatus game_step(GameState *state, SimInput input) {
+    if (state->status != Game_Playing) {
+        return state->status;
+    }
+
+    Dir dir = state->dir;
+    if (input.turn && input.turn != dir_opposite(dir)) {
+        dir = input.turn;
+    }
+
+    Cell next = snake_next_head(&state->snake, dir);
+    b32 ate_apple = next.x == state->apple.x && next.y == state->apple.y;
+    state->dir = dir;
+    state->ticks++;
+
+    if (snake_step(&state->snake, &state->board, dir, ate_apple)) {
+        state->status = Game_Dead;
+        b32 wall = next.x < 0 || next.x >= state->board.width || next.y < 0 || next.y >= state->board.height;
+        state->cause = wall ? Death_Wall : Death_Body;
+    } else if (ate_apple && !spawn_apple(&state->board, &state->rng, &state->apple)) {
+        state->status = Game_Won;
+    }
+    return state->status;
+}
+
+u64 snapshot_max_size(int width, int height) {
+    u64 cells = (u64)width * height;
+    return sizeof(GameSnapshot) + cells * sizeof(Cell);
+}
+
+// Writes state into snapshot, which must have room for snapshot_max_size
+// bytes. Only the live part of the body is copied. Returns the bytes used.
+u64 game_snapshot(GameState *state, GameSnapshot *snapshot) {
+    Board *board = &state->board;
+    Snake *snake = &state->snake;
+
+    snapshot->width = board->width;
+    snapshot->height = board->height;
+    snapshot->length = snake->length;
+    snapshot->rng = state->rng;
+    snapshot->apple = state->apple;
+    snapshot->dir = state->dir;
+    snapshot->status = state->status;
+    snapshot->cause = state->cause;
+    snapshot->ticks = state->ticks;
+
+    u8 *at = (u8 *)(snapshot + 1);
+    // The body may wrap around the end of the ring, so copy it in up to two runs.
+    int tail = (snake->head - (snake->length - 1)) & (snake->capacity - 1);
+    int first = snake->capacity - tail;
+    if (first > snake->length) first = snake->length;
+    memcpy(at, snake->cells + tail, first * sizeof(Cell));
+    memcpy(at + first * sizeof(Cell), snake->cells, (snake->length - first) * sizeof(Cell));
+    at += snake->length * sizeof(Cell);
+
+    snapshot->size = (u64)(at - (u8 *)snapshot);
+    return snapshot->size;
+}
+
+void game_restore(GameState *state, const GameSnapshot *snapshot) {
+    Board *board = &state->board;
+    Snake *snake = &state->snake;
+
+    // Take the current body off the board and put the snapshot's on. A dead
+    // head may sit in a wall or on another body cell, so only in-bounds cells
+    // are touched and each only once.
+    for (int i = 0; i < snake->length; i++) {
+        Cell *cell = snake_cell(snake, i);
+        if (board_in_bounds(board, cell->x, cell->y) && board_test(board, cell->x, cell->y)) {
+            board_vacate(board, cell->x, cell->y);
+        }
+    }
+
+    if (snake->capacity < snapshot->length) {
+        snake_reserve(snake, snapshot->length);
+    }
+    memcpy(snake->cells, (const u8 *)(snapshot + 1), snapshot->length * sizeof(Cell));
+    snake->length = snapshot->length;
+    snake->head = snapshot->length - 1;
+    for (int i = 0; i < snake->length; i++) {
+        Cell *cell = &snake->cells[i];
+        if (board_in_bounds(board, cell->x, cell->y) && !board_test(board, cell->x, cell->y)) {
+            board_occupy(board, cell->x, cell->y);
+        }
+    }
+
+    state->rng = snapshot->rng;
+    state->apple = snapshot->apple;
+    state->dir = snapshot->dir;
+    state->status = snapshot->status;
+    state->cause = snapshot->cause;
+    state->ticks = snapshot->ticks;
+}
+
+SnapshotPool snapshot_pool_create(int width, int height, int count) {
+    SnapshotPool pool{};
+    pool.slot_size = (snapshot_max_size(width, height) + 63) & ~(u64)63;
+    pool.count = count;
+    pool.arena = arena_create(pool.slot_size * count);
+    pool.slots = (u8 *)arena_push(&pool.arena, pool.slot_size * count);
+    return pool;
+}
+
+void snapshot_pool_free(SnapshotPool *pool) {
+    arena_release(&pool->arena);
+    *pool = {};
+}
@@ -0,0 +1,226 @@
+#ifndef SNAKE_SIM_H
+#define SNAKE_SIM_H
+
+// Game rules with no SDL or GL dependency. The front end in snake.cpp and
+// the headless tools all drive the game through game_step.
+
+#include "snake_base.h"
+
+enum Dir {
+    Left = 1,
+    Right,
+    Up,
+    Down,
+};
+
+struct Cell {
+    int x;
+    int y;
+    Dir dir;
+
+    Cell() {
+        x = 0;
+        y = 0;
+        dir = (Dir)0;
+    }
+
+    Cell(int x, int y) {
+        this->x = x;
+        this->y = y;
+        dir = (Dir)0;
+    }
+
+    Cell(int x, int y, Dir dir) {
+        this->x = x;
+        this->y = y;
+        this->dir = dir;
+    }
+};
+
+// xoshiro256** generator. Each game owns one, so runs are reproducible from
+// their seed and threads never share RNG state. rng_jump advances by 2^128
+// steps, which gives non-overlapping streams for parallel games.
+struct Rng {
+    u64 s[4];
+};
+
+// Linear allocator over a reserved range of address space. Pages are
+// committed as the arena grows, so pointers into it never move.
+struct MemoryArena {
+    u8 *base;
+    u64 reserved;
+    u64 committed;
+    u64 used;
+};
+
+// Ring buffer of body cells. cells[head] is the head and the body runs
+// backwards from there, so a tick only pushes a head and pops a tail.
+// capacity must be a power of two. When the ring fills up it doubles in
+// place inside its own arena, up to max_capacity.
+struct Snake {
+    Cell *cells;
+    int capacity;
+    int max_capacity;
+    int head;
+    int length;
+    MemoryArena *arena;
+};
+
+// Occupancy bitmap of the board, one bit per cell. The playable area is
+// padded by one cell on every side and the padding is always set, so a
+// single bit test covers both walls and the body.
+//
+// The bits past the last padding cell are set as well, so the clear bits
+// are exactly the free cells. block_free counts them per BOARD_BLOCK_WORDS
+// words, which lets an apple go on the k-th free cell after a short scan.
+// That pick depends only on which cells are free, never on the order the
+// game freed them in.
+#define BOARD_BLOCK_WORDS 32
+
+struct Board {
+    int width;
+    int height;
+    int stride;
+    u64 *bits;
+
+    int *block_free;
+    int free_count;
+};
+
+enum GameStatus {
+    Game_Playing,
+    Game_Dead,
+    Game_Won,
+};
+
+enum DeathCause {
+    Death_None,
+    Death_Wall,
+    Death_Body,
+};
+
+struct SimInput {
+    Dir turn; // 0 keeps the current direction
+};
+
+// Owns its arenas, and snake.arena points back into the struct, so a
+// GameState must stay where game_init put it.
+struct GameState {
+    MemoryArena board_arena;
+    MemoryArena snake_arena;
+    Board board;
+    Snake snake;
+    Rng rng;
+    Cell apple;
+    Dir dir;
+    GameStatus status;
+    DeathCause cause;
+    u64 ticks;
+};
+
+// Flat copy of a GameState: this header, then the body from tail to head.
+// It holds no pointers, so a snapshot can be memcpy'd between preallocated
+// slots and restored into any GameState with the same board size without
+// allocating. The board is rebuilt from the body, so both cost O(length).
+struct GameSnapshot {
+    s32 width;
+    s32 height;
+    s32 length;
+    Rng rng;
+    Cell apple;
+    Dir dir;
+    GameStatus status;
+    DeathCause cause;
+    u64 ticks;
+    u64 size; // bytes in use, header included
+};
+
+// Fixed-size snapshot slots carved out of one arena.
+struct SnapshotPool {
+    MemoryArena arena;
+    u64 slot_size;
+    int count;
+    u8 *slots;
+};
+
+u64 splitmix64(u64 *state);
+
+void rng_seed(Rng *rng, u64 seed);
+u64 rng_next(Rng *rng);
+u32 rng_below(Rng *rng, u32 count);
+void rng_jump(Rng *rng);
+Rng rng_split(Rng *rng);
+
+void *platform_reserve(u64 size);
+b32 platform_commit(void *ptr, u64 size);
+void platform_release(void *ptr, u64 size);
+const void *platform_map_file(const char *path, u64 *size);
+void platform_unmap_file(const void *ptr, u64 size);
+
+MemoryArena arena_create(u64 reserve_size);
+void *arena_push(MemoryArena *arena, u64 size);
+void arena_release(MemoryArena *arena);
+void arena_report(const char *name, MemoryArena *arena);
+
+inline int board_index(Board *board, int x, int y) {
+    return (y + 1) * board->stride + (x + 1);
+}
+
+inline b32 board_in_bounds(Board *board, int x, int y) {
+    return x >= 0 && x < board->width && y >= 0 && y < board->height;
+}
+
+inline b32 board_test(Board *board, int x, int y) {
+    int index = board_index(board, x, y);
+    return (board->bits[index >> 6] >> (index & 63)) & 1;
+}
+
+inline void board_set(Board *board, int x, int y) {
+    int index = board_index(board, x, y);
+    board->bits[index >> 6] |= 1ull << (index & 63);
+}
+
+inline void board_clear(Board *board, int x, int y) {
+    int index = board_index(board, x, y);
+    board->bits[index >> 6] &= ~(1ull << (index & 63));
+}
+
+u64 board_storage_size(int width, int height);
+Board board_create(MemoryArena *arena, int width, int height);
+void board_reset(Board *board);
+void board_occupy(Board *board, int x, int y);
+void board_vacate(Board *board, int x, int y);
+
+inline Cell *snake_cell(Snake *snake, int index) {
+    return &snake->cells[(snake->head - index) & (snake->capacity - 1)];
+}
+
+Snake snake_create(MemoryArena *arena, int max_length);
+void snake_reset(Snake *snake);
+void snake_reserve(Snake *snake, int capacity);
+void snake_push_head(Snake *snake, Cell cell);
+void snake_pop_tail(Snake *snake);
+Cell snake_next_head(Snake *snake, Dir dir);
+b32 snake_step(Snake *snake, Board *board, Dir dir, b32 grow);
+
+b32 spawn_apple(Board *board, Rng *rng, Cell *apple);
+
+Dir dir_opposite(Dir dir);
+
+void game_init(GameState *state, int width, int height, u64 seed);
+void game_reset(GameState *state, u64 seed);
+void game_free(GameState *state);
+GameStatus game_step(GameState *state, SimInput input);
+
+u64 snapshot_max_size(int width, int height);
+u64 game_snapshot(GameState *state, GameSnapshot *snapshot);
+void game_restore(GameState *state, const GameSnapshot *snapshot);
+
+SnapshotPool snapshot_pool_create(int width, int height, int count);
+void snapshot_pool_free(SnapshotPool *pool);
+
+inline GameSnapshot *snapshot_slot(SnapshotPool *pool, int index) {
+    return (GameSnapshot *)(pool->slots + (u64)index * pool->slot_size);
+}
+
+#endif // SNAKE_SIM_H
@@ -0,0 +1,94 @@
+#include "snake_watch.h"
+
+#include <stdio.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// How often the thread checks for quit, and how long it waits for an
+// editor to finish a save before raising the flag.
+#define WATCH_TIMEOUT_MS 250
+#define WATCH_SETTLE_MS 50
+
+#if defined(_WIN32)
+
+static void watch_run(FileWatch *watch, HANDLE handle) {
+    while (!watch->quit.load()) {
+        if (WaitForSingleObject(handle, WATCH_TIMEOUT_MS) == WAIT_OBJECT_0) {
+            Sleep(WATCH_SETTLE_MS);
+            watch->changed.store(true);
+            if (!FindNextChangeNotification(handle)) break;
+        }
+    }
+    FindCloseChangeNotification(handle);
+}
+
+b32 watch_start(FileWatch *watch, const char *dir) {
+    watch->changed.store(false);
+    watch->quit.store(false);
+    watch->running = false;
+    HANDLE handle = FindFirstChangeNotificationA(dir, FALSE,
+                                                 FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (handle == INVALID_HANDLE_VALUE) {
+        printf("Failed to watch %s\n", dir);
+        return false;
+    }
+    watch->thread = std::thread(watch_run, watch, handle);
+    watch->running = true;
+    return true;
+}
+
+#else
+
+static void drain(int fd) {
+    char buffer[4096];
+    while (read(fd, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+static void watch_run(FileWatch *watch, int fd) {
+    pollfd entry = {fd, POLLIN, 0};
+    while (!watch->quit.load()) {
+        if (poll(&entry, 1, WATCH_TIMEOUT_MS) > 0) {
+            usleep(WATCH_SETTLE_MS * 1000);
+            drain(fd);
+            watch->changed.store(true);
+        }
+    }
+    close(fd);
+}
+
+b32 watch_start(FileWatch *watch, const char *dir) {
+    watch->changed.store(false);
+    watch->quit.store(false);
+    watch->running = false;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        printf("Failed to watch %s\n", dir);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    watch->thread = std::thread(watch_run, watch, fd);
+    watch->running = true;
+    return true;
+}
+
+#endif
+
+b32 watch_changed(FileWatch *watch) {
+    return watch->running && watch->changed.exchange(false);
+}
+
+void watch_stop(FileWatch *watch) {
+    if (!watch->running) return;
+    watch->quit.store(true);
+    watch->thread.join();
+    watch->running = false;
+}
@@ -0,0 +1,25 @@
+#ifndef SNAKE_WATCH_H
+#define SNAKE_WATCH_H
+
+// Watches one directory from a background thread and raises a flag when a
+// file in it is written, created or renamed into it. The thread never
+// touches GL; the frame loop polls the flag and reloads on its own thread.
+
+#include <atomic>
+#include <thread>
+
+#include "snake_base.h"
+
+struct FileWatch {
+    std::thread thread;
+    std::atomic<b32> changed;
+    std::atomic<b32> quit;
+    b32 running;
+};
+
+b32 watch_start(FileWatch *watch, const char *dir);
+// True once for each burst of changes since the last call.
+b32 watch_changed(FileWatch *watch);
+void watch_stop(FileWatch *watch);
+
+#endif // SNAKE_WATCH_H
@@ -0,0 +1,19 @@
+// Sprite batch fragment shader.
+//
+// uv is relative to the sprite and rect is the sprite's part of the atlas
+// in texels. Picking the texel by hand does what GL_NEAREST with GL_REPEAT
+// or GL_CLAMP_TO_EDGE did per texture, and never samples a neighbour in
+// the atlas.
+
+in vec2 uv;
+flat in vec4 rect;
+flat in float repeat;
+
+uniform sampler2D atlas;
+
+out vec4 out_color;
+
+void main() {
+    vec2 p = clamp(mix(uv, fract(uv), repeat) * rect.zw, vec2(0.0), rect.zw - 1.0);
+    out_color = texelFetch(atlas, ivec2(rect.xy) + ivec2(p), 0);
+}
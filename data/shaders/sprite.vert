@@ -0,0 +1,31 @@
+// Sprite batch vertex shader. The loader prepends #version and defines
+// SPRITE_COUNT.
+//
+// One instance per quad: in_rect is the quad in pixels, in_uv_rect the
+// UVs relative to the sprite, in_rotation degrees clockwise about the
+// centre after scaling, as HMM_Rotate_LH.
+
+layout (location = 0) in vec2 in_pos;
+layout (location = 1) in vec2 in_uv;
+layout (location = 2) in vec4 in_rect;
+layout (location = 3) in vec4 in_uv_rect;
+layout (location = 4) in float in_rotation;
+layout (location = 5) in uint in_sprite;
+
+uniform mat4 projection;
+uniform vec4 sprite_rect[SPRITE_COUNT];
+uniform uint sprite_repeat;
+
+out vec2 uv;
+flat out vec4 rect;
+flat out float repeat;
+
+void main() {
+    float angle = -radians(in_rotation);
+    vec2 p = (in_pos - 0.5) * in_rect.zw;
+    p = vec2(p.x * cos(angle) - p.y * sin(angle), p.x * sin(angle) + p.y * cos(angle));
+    gl_Position = projection * vec4(in_rect.xy + 0.5 * in_rect.zw + p, 0.0, 1.0);
+    uv = mix(in_uv_rect.xy, in_uv_rect.zw, in_uv);
+    rect = sprite_rect[in_sprite];
+    repeat = float((sprite_repeat >> in_sprite) & 1u);
+}